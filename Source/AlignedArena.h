@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    AlignedArena.h
+
+    One aligned heap block that an owner carves all of its buffers out of,
+    so preparing means a single allocation and processing none. Every block
+    handed out starts on an AlignedBuffer::alignment boundary.
+
+    Sizing is done by running the same sequence of take() calls twice: with
+    nothing allocated take() only adds up the bytes asked for and returns
+    nullptr, then allocate(getNumBytesUsed()) makes room for exactly that
+    and, after rewind(), the second run hands out the real pointers.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "AlignedBuffer.h"
+
+//==============================================================================
+class AlignedArena
+{
+public:
+    static constexpr size_t alignment = AlignedBuffer<char>::alignment;
+
+    AlignedArena() = default;
+
+    // bytes a block of numElements elements occupies, padded so the block
+    // after it stays aligned
+    template <typename Type>
+    static size_t getBlockSize(size_t numElements) {
+        return (numElements * sizeof(Type) + alignment - 1) / alignment * alignment;
+    }
+
+    // allocates numBytes cleared bytes and hands them out again from the
+    // start. not real-time safe.
+    void allocate(size_t numBytes) {
+        storage.allocate(numBytes);
+        used = 0;
+    }
+
+    // hands the same storage out again from the start
+    void rewind() {
+        used = 0;
+    }
+
+    // drops the storage, take() goes back to only counting
+    void release() {
+        storage.allocate(0);
+        used = 0;
+    }
+
+    // the next numElements elements, cleared when fresh from allocate()
+    template <typename Type>
+    Type* take(size_t numElements) {
+        const size_t offset = used;
+        used += getBlockSize<Type>(numElements);
+        if (storage.getSize() == 0) {
+            return nullptr;
+        }
+        // the arena was sized for fewer blocks than are taken from it
+        jassert(used <= storage.getSize());
+        return reinterpret_cast<Type*>(storage.get() + offset);
+    }
+
+    size_t getSize() const { return storage.getSize(); }
+    size_t getNumBytesUsed() const { return used; }
+
+private:
+    AlignedBuffer<char> storage;
+    size_t used = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (AlignedArena)
+};
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    AlignedBuffer.h
+
+    Heap array whose first element sits on a 64 byte boundary (a full avx-512
+    vector, and more than any fftw build asks for), so the transforms can run
+    straight on it without copying into buffers of their own.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+template <typename Type>
+class AlignedBuffer
+{
+public:
+    static constexpr size_t alignment = 64;
+
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(size_t numElements) { allocate(numElements); }
+
+    // allocates numElements cleared elements, dropping the old contents.
+    // not real-time safe.
+    void allocate(size_t numElements) {
+        storage.calloc(numElements * sizeof(Type) + alignment);
+        const auto address = reinterpret_cast<uintptr_t>(storage.get());
+        data = reinterpret_cast<Type*>((address + alignment - 1) & ~(uintptr_t) (alignment - 1));
+        size = numElements;
+    }
+
+    void clear() {
+        std::fill(data, data + size, Type());
+    }
+
+    Type* get() const { return data; }
+    Type& operator[](size_t index) const { return data[index]; }
+    size_t getSize() const { return size; }
+
+private:
+    juce::HeapBlock<char> storage;
+    Type* data = nullptr;
+    size_t size = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (AlignedBuffer)
+};
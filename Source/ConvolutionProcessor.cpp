@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    ConvolutionProcessor.cpp
+
+  ==============================================================================
+*/
+
+#include "ConvolutionProcessor.h"
+#include "StftEngine.h"
+#include "SpectralFrame.h"
+#include "SpectralOps.h"
+
+//==============================================================================
+std::shared_ptr<const ImpulseResponse> makeImpulseResponse(const juce::AudioBuffer<float>& samples, double sampleRate) {
+    auto response = std::make_shared<ImpulseResponse>();
+    response->sampleRate = sampleRate;
+    const int numSamples = juce::jmin(samples.getNumSamples(), (int) (maxImpulseResponseSeconds * sampleRate));
+    response->samples.setSize(samples.getNumChannels(), numSamples);
+    for (int ch=0; ch<samples.getNumChannels(); ch++) {
+        response->samples.copyFrom(ch, 0, samples, ch, 0, numSamples);
+    }
+    return response;
+}
+
+std::shared_ptr<const ImpulseResponse> readImpulseResponse(const juce::File& file) {
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->numChannels == 0 || reader->sampleRate <= 0) {
+        return nullptr;
+    }
+    const auto maxSamples = (juce::int64) (maxImpulseResponseSeconds * reader->sampleRate);
+    const int numSamples = (int) juce::jmin(reader->lengthInSamples, maxSamples);
+    juce::AudioBuffer<float> samples((int) reader->numChannels, numSamples);
+    reader->read(&samples, 0, numSamples, 0, true, true);
+    return makeImpulseResponse(samples, reader->sampleRate);
+}
+
+std::shared_ptr<const ImpulseResponse> resampleImpulseResponse(const ImpulseResponse& response, double sampleRate) {
+    if (response.sampleRate == sampleRate || response.sampleRate <= 0) {
+        return makeImpulseResponse(response.samples, sampleRate);
+    }
+
+    // input samples per output sample. a convolution sums over all taps, so
+    // n times as many taps need 1/n of the gain each.
+    const double ratio = response.sampleRate / sampleRate;
+    const int numSamples = juce::jmin((int) std::ceil(response.getNumSamples() / ratio),
+                                      (int) (maxImpulseResponseSeconds * sampleRate));
+    auto resampled = std::make_shared<ImpulseResponse>();
+    resampled->sampleRate = sampleRate;
+    resampled->samples.setSize(response.getNumChannels(), numSamples);
+    for (int ch=0; ch<response.getNumChannels(); ch++) {
+        juce::LagrangeInterpolator interpolator;
+        interpolator.process(ratio, response.samples.getReadPointer(ch), resampled->samples.getWritePointer(ch),
+                             numSamples, response.getNumSamples(), 0);
+        juce::FloatVectorOperations::multiply(resampled->samples.getWritePointer(ch), (float) ratio, numSamples);
+    }
+    return resampled;
+}
+
+//==============================================================================
+void ConvolutionProcessor::prepare(int fftSize, int hop, int channels) {
+    hopSize = hop;
+    numChannels = channels;
+    paddedNumBins = SpectralFrame::getPaddedNumBins(fftSize);
+    channelStride = SpectralFrame::getChannelStride(fftSize);
+    numPartitions = 0;
+}
+
+void ConvolutionProcessor::configure(const StftConfig& config, FftBackend& backend) {
+    const auto* response = config.impulseResponse.get();
+    if (response == nullptr || response->getNumSamples() == 0 || response->getNumChannels() == 0) {
+        return;
+    }
+    // a partition of one hop, plus the hop of output kept, has to fit a frame
+    jassert(config.window == WindowType::overlapSave && 2 * hopSize <= config.fftSize);
+
+    numResponseChannels = response->getNumChannels();
+    numPartitions = (response->getNumSamples() + hopSize - 1) / hopSize;
+    partitions.allocate((size_t) numResponseChannels * (size_t) numPartitions * (size_t) channelStride);
+    delayLine.allocate((size_t) numChannels * (size_t) numPartitions * (size_t) channelStride);
+
+    // every partition zero padded to a whole frame, at its start: the
+    // product with a frame then holds the partition's contribution to the
+    // newest hop, undisturbed by the circular wrap
+    AlignedBuffer<float> block((size_t) config.fftSize);
+    for (int ch=0; ch<numResponseChannels; ch++) {
+        const float* samples = response->samples.getReadPointer(ch);
+        for (int p=0; p<numPartitions; p++) {
+            const int start = p * hopSize;
+            block.clear();
+            juce::FloatVectorOperations::copy(block.get(), samples + start, juce::jmin(hopSize, response->getNumSamples() - start));
+            float* real = partitions.get() + ((size_t) ch * numPartitions + p) * channelStride;
+            backend.forwardSplit(block.get(), real, real + paddedNumBins, 1, channelStride);
+        }
+    }
+}
+
+void ConvolutionProcessor::reset() {
+    delayLine.clear();
+}
+
+//==============================================================================
+void ConvolutionProcessor::processSpectrum(SpectrumSpan spectrum, int channel, juce::int64 frameTime) {
+    if (numPartitions == 0) {
+        return;
+    }
+    const int numBins = spectrum.numBins;
+
+    // frame f is stored in slot f % numPartitions, partition p multiplies
+    // the input of frame f - p
+    const int newest = (int) ((frameTime / hopSize) % numPartitions);
+    float* lines = delayLine.get() + (size_t) channel * numPartitions * channelStride;
+    float* newestReal = lines + (size_t) newest * channelStride;
+    juce::FloatVectorOperations::copy(newestReal, spectrum.real, numBins);
+    juce::FloatVectorOperations::copy(newestReal + paddedNumBins, spectrum.imag, numBins);
+
+    const float* responses = partitions.get()
+        + (size_t) juce::jmin(channel, numResponseChannels - 1) * numPartitions * channelStride;
+    juce::FloatVectorOperations::clear(spectrum.real, numBins);
+    juce::FloatVectorOperations::clear(spectrum.imag, numBins);
+    int slot = newest;
+    for (int p=0; p<numPartitions; p++) {
+        const float* x = lines + (size_t) slot * channelStride;
+        const float* h = responses + (size_t) p * channelStride;
+        spectralops::multiplyAdd(spectrum.real, spectrum.imag, x, x + paddedNumBins, h, h + paddedNumBins, numBins);
+        slot = slot == 0 ? numPartitions - 1 : slot - 1;
+    }
+}
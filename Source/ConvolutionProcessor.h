@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    ConvolutionProcessor.h
+
+    Uniformly partitioned fft convolution on top of the stft engine. With the
+    overlapSave window and a hop of fftSize/2 every frame is the newest
+    fftSize input samples, and only the newest hop of its inverse transform
+    is kept, which is overlap-save. The impulse response is cut into
+    partitions of one hop, each transformed once when the engine is built.
+    Every frame the processor pushes the input spectrum into a frequency
+    domain delay line and multiply-adds it with the partition spectra, so the
+    work per hop is the same for every hop: no partition is ever transformed
+    on the audio thread, and a long response costs more complex multiplies
+    per hop, never a spike.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include "SpectralProcessor.h"
+#include "AlignedBuffer.h"
+
+//==============================================================================
+// an impulse response and the rate it was sampled at, immutable once made so
+// engines and the plugin can share it
+struct ImpulseResponse
+{
+    juce::AudioBuffer<float> samples;
+    double sampleRate = 0.0;
+
+    int getNumChannels() const { return samples.getNumChannels(); }
+    int getNumSamples() const { return samples.getNumSamples(); }
+};
+
+// longer impulse responses are cut to this
+static constexpr double maxImpulseResponseSeconds = 10.0;
+
+// copies numChannels channels of samples into a new impulse response, at most
+// maxImpulseResponseSeconds long
+std::shared_ptr<const ImpulseResponse> makeImpulseResponse(const juce::AudioBuffer<float>& samples, double sampleRate);
+// reads an audio file of any of the basic formats, nullptr if it can't
+std::shared_ptr<const ImpulseResponse> readImpulseResponse(const juce::File& file);
+// the response at another sample rate, with its gain kept per second
+std::shared_ptr<const ImpulseResponse> resampleImpulseResponse(const ImpulseResponse& response, double sampleRate);
+
+//==============================================================================
+class ConvolutionProcessor : public SpectralProcessor<ConvolutionProcessor>
+{
+public:
+    void prepare(int fftSize, int hopSize, int numChannels);
+    // transforms the partitions of config.impulseResponse with the engine's
+    // backend and allocates the delay line
+    void configure(const StftConfig& config, FftBackend& backend);
+    void reset();
+
+    void processSpectrum(SpectrumSpan spectrum, int channel, juce::int64 frameTime);
+
+private:
+    int hopSize = 0;
+    int numChannels = 0;
+    int paddedNumBins = 0;
+    int channelStride = 0;
+
+    // zero without an impulse response, the spectrum is left untouched
+    int numPartitions = 0;
+    int numResponseChannels = 0;
+    // the split spectrum of partition p of response channel c is at
+    // (c * numPartitions + p) * channelStride, the layout of a SpectralFrame
+    AlignedBuffer<float> partitions;
+    // the input spectra of the last numPartitions frames of every channel,
+    // same layout, a ring indexed by frame number
+    AlignedBuffer<float> delayLine;
+};
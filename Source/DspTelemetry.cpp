@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    DspTelemetry.cpp
+
+  ==============================================================================
+*/
+
+#include "DspTelemetry.h"
+
+//==============================================================================
+const char* getDspStageName(DspStage stage) {
+    switch (stage) {
+        case DspStage::unwrap:     return "Unwrap";
+        case DspStage::forwardFft: return "Forward FFT";
+        case DspStage::spectral:   return "Spectral";
+        case DspStage::inverseFft: return "Inverse FFT";
+        case DspStage::writeBack:  return "Write Back";
+    }
+    return "";
+}
+
+double CycleCounter::getTicksPerSecond() {
+   #if JUCE_INTEL
+    // count cycles over a known stretch of the high resolution clock
+    static const double ticksPerSecond = [] {
+        const auto clockStart = juce::Time::getHighResolutionTicks();
+        const auto cycleStart = now();
+        juce::Thread::sleep(20);
+        const auto cycles = now() - cycleStart;
+        const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - clockStart);
+        return (double) cycles / seconds;
+    }();
+    return ticksPerSecond;
+   #else
+    return (double) juce::Time::getHighResolutionTicksPerSecond();
+   #endif
+}
+
+//==============================================================================
+DspTelemetry::DspTelemetry()
+{
+}
+
+void DspTelemetry::prepare(double newSampleRate) {
+    sampleRate = newSampleRate;
+    ticksPerSecond = CycleCounter::getTicksPerSecond();
+    reset();
+}
+
+void DspTelemetry::reset() {
+    load.store(0.0f);
+    worstLoad.store(0.0f);
+    worstCallbackCycles.store(0);
+    numCallbacks.store(0);
+    numRiskyCallbacks.store(0);
+    numOverruns.store(0);
+    for (auto& bucket : loadHistogram) {
+        bucket.store(0);
+    }
+    for (int i=0; i<numDspStages; i++) {
+        stageCycles[i].store(0);
+        stageRuns[i].store(0);
+    }
+}
+
+void DspTelemetry::addCallback(juce::uint64 cycles, int numSamples) {
+    if (numSamples <= 0) {
+        return;
+    }
+    // share of the time the block's audio lasts that processing it took
+    const double seconds = (double) cycles / ticksPerSecond.load(std::memory_order_relaxed);
+    const float callbackLoad = (float) (seconds * sampleRate / numSamples);
+
+    // roughly a 100 ms average at usual block sizes
+    const float smoothing = 0.05f;
+    load.store(load.load(std::memory_order_relaxed) * (1.0f - smoothing) + callbackLoad * smoothing, std::memory_order_relaxed);
+
+    // single writer, a plain compare is enough for the maxima
+    if (callbackLoad > worstLoad.load(std::memory_order_relaxed)) {
+        worstLoad.store(callbackLoad, std::memory_order_relaxed);
+    }
+    if (cycles > worstCallbackCycles.load(std::memory_order_relaxed)) {
+        worstCallbackCycles.store(cycles, std::memory_order_relaxed);
+    }
+
+    const int bucket = juce::jlimit(0, numLoadBuckets - 1, (int) (callbackLoad * 10.0f));
+    loadHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    numCallbacks.fetch_add(1, std::memory_order_relaxed);
+    if (callbackLoad >= riskLoad) {
+        numRiskyCallbacks.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (callbackLoad >= 1.0f) {
+        numOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void DspTelemetry::addStageTimes(StageTimes& times) {
+    for (int i=0; i<numDspStages; i++) {
+        juce::uint64 cycles;
+        juce::uint32 runs;
+        times.take((DspStage) i, cycles, runs);
+        if (runs > 0) {
+            stageCycles[i].fetch_add(cycles, std::memory_order_relaxed);
+            stageRuns[i].fetch_add(runs, std::memory_order_relaxed);
+        }
+    }
+}
+
+DspTelemetry::Snapshot DspTelemetry::getSnapshot() const {
+    Snapshot snapshot;
+    const double ticks = ticksPerSecond.load(std::memory_order_relaxed);
+    snapshot.load = load.load(std::memory_order_relaxed);
+    snapshot.worstLoad = worstLoad.load(std::memory_order_relaxed);
+    snapshot.worstCallbackSeconds = (double) worstCallbackCycles.load(std::memory_order_relaxed) / ticks;
+    snapshot.numCallbacks = numCallbacks.load(std::memory_order_relaxed);
+    snapshot.numRiskyCallbacks = numRiskyCallbacks.load(std::memory_order_relaxed);
+    snapshot.numOverruns = numOverruns.load(std::memory_order_relaxed);
+    for (int i=0; i<numLoadBuckets; i++) {
+        snapshot.loadHistogram[i] = loadHistogram[i].load(std::memory_order_relaxed);
+    }
+    for (int i=0; i<numDspStages; i++) {
+        snapshot.stageSeconds[i] = (double) stageCycles[i].load(std::memory_order_relaxed) / ticks;
+        snapshot.stageRuns[i] = stageRuns[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    DspTelemetry.h
+
+    Timing of the audio callback and of the stages of every stft frame,
+    published lock free. Times are taken with the cpu's cycle counter (rdtsc
+    on x86, the high resolution tick counter elsewhere) and only turned into
+    seconds where they are read.
+
+    The engine adds the cycles of each frame stage to its StageTimes (from
+    whichever thread runs the frames). Once per block processBlock moves
+    them into the processor's DspTelemetry, together with the duration of
+    the callback, which goes into a histogram of deadline use. Every counter
+    is a relaxed atomic with a single writer, so publishing never locks or
+    allocates, and the editor reads them whenever it likes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+// the stages processFft is made of
+enum class DspStage
+{
+    unwrap,
+    forwardFft,
+    spectral,
+    inverseFft,
+    writeBack
+};
+
+constexpr int numDspStages = 5;
+
+const char* getDspStageName(DspStage stage);
+
+//==============================================================================
+namespace CycleCounter
+{
+    inline juce::uint64 now() {
+       #if JUCE_INTEL
+        return (juce::uint64) __rdtsc();
+       #else
+        return (juce::uint64) juce::Time::getHighResolutionTicks();
+       #endif
+    }
+
+    // counter rate, measured against the high resolution clock on the first
+    // call (which takes about 20 ms). not real-time safe the first time.
+    double getTicksPerSecond();
+}
+
+//==============================================================================
+// cycles and number of runs per stage, added up since the last take()
+class StageTimes
+{
+public:
+    void add(DspStage stage, juce::uint64 cycles) {
+        cyclesSpent[(int) stage].fetch_add(cycles, std::memory_order_relaxed);
+        numRuns[(int) stage].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // moves the totals of stage out, resetting them
+    void take(DspStage stage, juce::uint64& cycles, juce::uint32& runs) {
+        cycles = cyclesSpent[(int) stage].exchange(0, std::memory_order_relaxed);
+        runs = numRuns[(int) stage].exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<juce::uint64> cyclesSpent[numDspStages] {};
+    std::atomic<juce::uint32> numRuns[numDspStages] {};
+};
+
+// times the scope it lives in as one run of a stage
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer(StageTimes& t, DspStage s) : times(t), stage(s), start(CycleCounter::now()) {}
+    ~ScopedStageTimer() { times.add(stage, CycleCounter::now() - start); }
+
+private:
+    StageTimes& times;
+    const DspStage stage;
+    const juce::uint64 start;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedStageTimer)
+};
+
+//==============================================================================
+class DspTelemetry
+{
+public:
+    // deadline use histogram: 10% wide buckets, the last one for callbacks
+    // that took longer than the audio they processed
+    static constexpr int numLoadBuckets = 11;
+    // a callback using this much of its deadline counts as an xrun risk
+    static constexpr double riskLoad = 0.8;
+
+    DspTelemetry();
+
+    // sets the rate the callback deadlines are worked out at and calibrates
+    // the cycle counter. not real-time safe.
+    void prepare(double sampleRate);
+    void reset();
+
+    // audio thread: times one callback of numSamples samples
+    class ScopedCallback
+    {
+    public:
+        ScopedCallback(DspTelemetry& t, int n) : telemetry(t), numSamples(n), start(CycleCounter::now()) {}
+        ~ScopedCallback() { telemetry.addCallback(CycleCounter::now() - start, numSamples); }
+
+    private:
+        DspTelemetry& telemetry;
+        const int numSamples;
+        const juce::uint64 start;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedCallback)
+    };
+
+    // audio thread: moves the stage times an engine has gathered
+    void addStageTimes(StageTimes& times);
+
+    // any thread, all values since the last reset
+    struct Snapshot
+    {
+        // smoothed deadline use of recent callbacks, 1 = 100%
+        float load = 0.0f;
+        float worstLoad = 0.0f;
+        double worstCallbackSeconds = 0.0;
+        juce::uint32 numCallbacks = 0;
+        juce::uint32 numRiskyCallbacks = 0;
+        juce::uint32 numOverruns = 0;
+        juce::uint32 loadHistogram[numLoadBuckets] {};
+        // totals per stage, compare two snapshots for the recent mean
+        double stageSeconds[numDspStages] {};
+        juce::uint32 stageRuns[numDspStages] {};
+    };
+    Snapshot getSnapshot() const;
+
+private:
+    void addCallback(juce::uint64 cycles, int numSamples);
+
+    double sampleRate = 44100.0;
+    std::atomic<double> ticksPerSecond { 1.0 };
+
+    std::atomic<float> load { 0.0f };
+    std::atomic<float> worstLoad { 0.0f };
+    std::atomic<juce::uint64> worstCallbackCycles { 0 };
+    std::atomic<juce::uint32> numCallbacks { 0 };
+    std::atomic<juce::uint32> numRiskyCallbacks { 0 };
+    std::atomic<juce::uint32> numOverruns { 0 };
+    std::atomic<juce::uint32> loadHistogram[numLoadBuckets] {};
+    std::atomic<juce::uint64> stageCycles[numDspStages] {};
+    std::atomic<juce::uint32> stageRuns[numDspStages] {};
+
+    JUCE_DECLARE_NON_COPYABLE (DspTelemetry)
+};
@@ -0,0 +1,213 @@
+/*
+  ==============================================================================
+
+    FftBackend.cpp
+
+  ==============================================================================
+*/
+
+#include "FftBackend.h"
+#include "FftwBackend.h"
+#include "JuceFftBackend.h"
+#include "RadixFftBackend.h"
+#include "FixedSizeFftBackend.h"
+#include "SpectralFrame.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+
+//==============================================================================
+void FftBackend::forwardBatch(const float* input, std::complex<float>* output, int numChannels) {
+    for (int ch=0; ch<numChannels; ch++) {
+        forward(input + ch * getSize(), output + ch * getNumBins());
+    }
+}
+
+void FftBackend::inverseBatch(const std::complex<float>* input, float* output, int numChannels) {
+    for (int ch=0; ch<numChannels; ch++) {
+        inverse(input + ch * getNumBins(), output + ch * getSize());
+    }
+}
+
+void FftBackend::forwardPair(const float* input, float* real, float* imag, int binStride) {
+    forwardSplit(input, real, imag, 2, binStride);
+}
+
+void FftBackend::inversePair(float* real, float* imag, float* output, int binStride) {
+    inverseSplit(real, imag, output, 2, binStride);
+}
+
+void FftBackend::separatePair(const float* zRe, const float* zIm, int zStep, int size, float* real, float* imag, int binStride) {
+    // with z = a + i * b and C[k] = conj(Z[size-k]):
+    // A[k] = (Z[k] + C[k]) / 2 and B[k] = -i * (Z[k] - C[k]) / 2
+    const int half = size / 2;
+    for (int k=0; k<=half; k++) {
+        const int mirror = k == 0 ? 0 : size - k;
+        const float zr = zRe[k * zStep];
+        const float zi = zIm[k * zStep];
+        const float cr = zRe[mirror * zStep];
+        const float ci = -zIm[mirror * zStep];
+
+        real[k] = 0.5f * (zr + cr);
+        imag[k] = 0.5f * (zi + ci);
+        real[binStride + k] = 0.5f * (zi - ci);
+        imag[binStride + k] = -0.5f * (zr - cr);
+    }
+}
+
+void FftBackend::combinePair(const float* real, const float* imag, int binStride, int size, float* zRe, float* zIm, int zStep) {
+    // Z = A + i * B over the full spectrum, the upper half from the
+    // conjugates of the lower one
+    const int half = size / 2;
+    const float* bRe = real + binStride;
+    const float* bIm = imag + binStride;
+    zRe[0] = real[0];
+    zIm[0] = bRe[0];
+    zRe[half * zStep] = real[half];
+    zIm[half * zStep] = bRe[half];
+    for (int k=1; k<half; k++) {
+        zRe[k * zStep] = real[k] - bIm[k];
+        zIm[k * zStep] = imag[k] + bRe[k];
+        zRe[(size - k) * zStep] = real[k] + bIm[k];
+        zIm[(size - k) * zStep] = bRe[k] - imag[k];
+    }
+}
+
+//==============================================================================
+static std::unique_ptr<FftBackend> createConcreteFftBackend(FftBackendType type, int fftSize) {
+    switch (type) {
+       #if FFT_USE_FFTW
+        case FftBackendType::fftw:  return std::make_unique<FftwBackend<FftPrecision>>();
+       #endif
+        case FftBackendType::juce:  return std::make_unique<JuceFftBackend>();
+        case FftBackendType::radix: return std::make_unique<RadixFftBackend>();
+        case FftBackendType::fixedSize:
+            if (fixedfft::isSupportedSize(fftSize)) {
+                return std::make_unique<FixedSizeFftBackend>();
+            }
+            break;
+        default: break;
+    }
+    // requested backend is not compiled in, fall back to the built-in one
+    return std::make_unique<RadixFftBackend>();
+}
+
+// times forward + inverse pairs and returns the best run in ticks, or the
+// largest value when the backend can't be prepared
+static juce::int64 benchmarkFftBackend(FftBackend& backend, int fftSize, int numChannels, bool packStereoPairs) {
+    backend.prepare(fftSize, numChannels);
+    if (! backend.isPrepared()) {
+        return std::numeric_limits<juce::int64>::max();
+    }
+
+    // the engine's buffers: aligned frames back to back, and the bins in the
+    // SpectralFrame layout
+    const int stride = SpectralFrame::getChannelStride(fftSize);
+    AlignedBuffer<float> frames((size_t) (numChannels * fftSize));
+    AlignedBuffer<float> bins((size_t) SpectralFrame::getNumFloats(fftSize, numChannels));
+    float* const timeData = frames.get();
+    float* const real = bins.get();
+    float* const imag = bins.get() + SpectralFrame::getPaddedNumBins(fftSize);
+    juce::Random random(fftSize);
+    for (int i=0; i<numChannels * fftSize; i++) {
+        timeData[i] = random.nextFloat() * 2.0f - 1.0f;
+    }
+
+    const int numRuns = 5;
+    const int pairsPerRun = juce::jmax(4, 65536 / (fftSize * numChannels));
+    juce::int64 best = std::numeric_limits<juce::int64>::max();
+
+    // one untimed run to warm up caches and fftw's lazy setup
+    for (int run=-1; run<numRuns; run++) {
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int i=0; i<pairsPerRun; i++) {
+            // the transforms the engine runs, see computeFft and computeIfft
+            if (packStereoPairs) {
+                backend.forwardPair(timeData, real, imag, stride);
+                backend.inversePair(real, imag, timeData, stride);
+            } else {
+                backend.forwardSplit(timeData, real, imag, numChannels, stride);
+                backend.inverseSplit(real, imag, timeData, numChannels, stride);
+            }
+            // keep the data bounded between iterations
+            juce::FloatVectorOperations::multiply(timeData, 1.0f / (float) fftSize, numChannels * fftSize);
+        }
+        const auto elapsed = juce::Time::getHighResolutionTicks() - start;
+        if (run >= 0) {
+            best = juce::jmin(best, elapsed);
+        }
+    }
+    return best;
+}
+
+FftBackendType resolveFftBackend(FftBackendType type, int fftSize, int numChannels, bool packStereoPairs) {
+    if (type != FftBackendType::automatic) {
+        return type;
+    }
+
+    // results are shared by every instance in the process. packing only
+    // applies to a stereo pair.
+    packStereoPairs = packStereoPairs && numChannels == 2;
+    const auto key = std::make_tuple(fftSize, numChannels, packStereoPairs);
+    static std::mutex cacheLock;
+    static std::map<std::tuple<int, int, bool>, FftBackendType> fastestBySize;
+
+    std::lock_guard<std::mutex> lock(cacheLock);
+    auto cached = fastestBySize.find(key);
+    if (cached != fastestBySize.end()) {
+        return cached->second;
+    }
+
+    std::vector<FftBackendType> candidates { FftBackendType::radix };
+   #if FFT_USE_FFTW
+    candidates.push_back(FftBackendType::fftw);
+   #endif
+    if (juce::isPowerOfTwo(fftSize)) {
+        candidates.push_back(FftBackendType::juce);
+    }
+    if (fixedfft::isSupportedSize(fftSize)) {
+        candidates.push_back(FftBackendType::fixedSize);
+    }
+
+    FftBackendType fastest = FftBackendType::radix;
+    juce::int64 fastestTicks = std::numeric_limits<juce::int64>::max();
+    for (auto candidate : candidates) {
+        auto backend = createConcreteFftBackend(candidate, fftSize);
+        const auto ticks = benchmarkFftBackend(*backend, fftSize, numChannels, packStereoPairs);
+        if (ticks == std::numeric_limits<juce::int64>::max()) {
+            continue;
+        }
+        DBG("fft backend " << backend->getName() << " size " << fftSize << " x" << numChannels
+            << (packStereoPairs ? " packed" : "") << ": "
+            << juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6 << " us");
+        if (ticks < fastestTicks) {
+            fastestTicks = ticks;
+            fastest = candidate;
+        }
+    }
+
+    fastestBySize[key] = fastest;
+    return fastest;
+}
+
+std::unique_ptr<FftBackend> createFftBackend(FftBackendType type, int fftSize, int numChannels, bool packStereoPairs) {
+    auto backend = createConcreteFftBackend(resolveFftBackend(type, fftSize, numChannels, packStereoPairs), fftSize);
+    backend->prepare(fftSize, numChannels);
+    if (! backend->isPrepared()) {
+        DBG("fft backend " << backend->getName() << " can't prepare size " << fftSize << ", using radix");
+        backend = std::make_unique<RadixFftBackend>();
+        backend->prepare(fftSize, numChannels);
+    }
+    return backend;
+}
+
+const char* getFftBackendName(FftBackendType type) {
+    switch (type) {
+        case FftBackendType::automatic: return "auto";
+        case FftBackendType::fftw:      return "fftw";
+        case FftBackendType::juce:      return "juce";
+        case FftBackendType::radix:     return "radix";
+        case FftBackendType::fixedSize: return "fixed";
+    }
+    return "";
+}
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    FftBackend.h
+
+    Common interface for the real FFT implementations the processor can run
+    on. All backends use the same conventions as fftw: forward() turns
+    getSize() real samples into getNumBins() = getSize()/2+1 complex bins and
+    inverse() goes back without scaling, so a forward/inverse round trip
+    multiplies the signal by getSize().
+
+    prepare() may allocate and plan, forward() and inverse() must not.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+#include <memory>
+
+// set FFT_USE_FFTW=0 on platforms where the fftw libraries can't be linked,
+// the juce, radix and fixed size backends are always available
+#ifndef FFT_USE_FFTW
+ #define FFT_USE_FFTW 1
+#endif
+
+//==============================================================================
+class FftBackend
+{
+public:
+    virtual ~FftBackend() = default;
+
+    virtual const char* getName() const = 0;
+
+    // allocates buffers and plans for the given transform size and number of
+    // channels per batch. not real-time safe, call it from prepareToPlay.
+    virtual void prepare(int fftSize, int numChannels) = 0;
+    // frees everything allocated by prepare
+    virtual void release() = 0;
+
+    virtual bool isPrepared() const = 0;
+    virtual int getSize() const = 0;
+    virtual int getNumChannels() const = 0;
+    int getNumBins() const { return getSize() / 2 + 1; }
+
+    // real input of getSize() samples -> getNumBins() complex bins
+    virtual void forward(const float* input, std::complex<float>* output) = 0;
+    // getNumBins() complex bins -> real output of getSize() samples (unscaled)
+    virtual void inverse(const std::complex<float>* input, float* output) = 0;
+
+    // same as above for numChannels frames stored one after the other
+    // (getSize() samples / getNumBins() bins apart). the default runs one
+    // transform per channel, backends that can batch override these.
+    virtual void forwardBatch(const float* input, std::complex<float>* output, int numChannels);
+    virtual void inverseBatch(const std::complex<float>* input, float* output, int numChannels);
+
+    // split layout, as kept by SpectralFrame: the bins of frame ch go to
+    // real + ch * binStride and imag + ch * binStride. this is what the stft
+    // engine runs on, input and output frames are getSize() samples apart.
+    // the inverse may overwrite its input bins, like fftw's c2r. backends
+    // transform straight between these buffers where they can, given 64 byte
+    // aligned frames and the SpectralFrame layout.
+    virtual void forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) = 0;
+    virtual void inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) = 0;
+
+    // stereo pair packing, split layout as above for exactly two channels.
+    // forwardPair runs both frames through one complex transform of
+    // getSize() points, the first in the real part and the second in the
+    // imaginary part, and separates the two half spectra by conjugate
+    // symmetry. inversePair recombines them into one complex spectrum and
+    // runs one inverse transform, the imaginary parts of dc and nyquist are
+    // ignored like the real inverse does. the defaults fall back to two real
+    // transforms, backends with a complex transform override them.
+    virtual void forwardPair(const float* input, float* real, float* imag, int binStride);
+    virtual void inversePair(float* real, float* imag, float* output, int binStride);
+
+    // bytes the backend copied between the caller's buffers and its own
+    // since the last call, to profile the frame pipeline
+    juce::int64 takeBytesCopied() {
+        const auto bytes = bytesCopied;
+        bytesCopied = 0;
+        return bytes;
+    }
+
+protected:
+    // conjugate symmetry helpers for the pair transforms. z holds size
+    // complex values, real and imaginary parts zStep floats apart from one
+    // value to the next (1 for split arrays, 2 for interleaved ones).
+    // separatePair turns the spectrum of first + i * second into the half
+    // spectra of both, combinePair does the reverse.
+    static void separatePair(const float* zRe, const float* zIm, int zStep, int size, float* real, float* imag, int binStride);
+    static void combinePair(const float* real, const float* imag, int binStride, int size, float* zRe, float* zIm, int zStep);
+
+    juce::int64 bytesCopied = 0;
+};
+
+//==============================================================================
+enum class FftBackendType
+{
+    automatic,  // benchmark the available backends and use the fastest one
+    fftw,
+    juce,
+    radix,
+    fixedSize   // compile-time kernels for sizes 64 to 8192, radix for others
+};
+
+// creates a backend prepared for fftSize and numChannels, resolving
+// FftBackendType::automatic first for the transforms that will run on it
+// (packStereoPairs for forwardPair/inversePair). backends that can't do
+// fftSize, or fail to prepare (e.g. fftw can't plan), are replaced by the
+// radix backend. check isPrepared() all the same before running transforms.
+std::unique_ptr<FftBackend> createFftBackend(FftBackendType type, int fftSize, int numChannels = 1,
+                                             bool packStereoPairs = false);
+
+// resolves FftBackendType::automatic into a concrete type. the first call for
+// a given size, channel count and packing runs a short benchmark of every
+// backend on this cpu, timing the split transforms the stft engine runs
+// (forwardSplit/inverseSplit over numChannels frames in the SpectralFrame
+// layout, or forwardPair/inversePair when packing a stereo pair). the result
+// is cached for the rest of the process. not real-time safe.
+FftBackendType resolveFftBackend(FftBackendType type, int fftSize, int numChannels = 1, bool packStereoPairs = false);
+
+const char* getFftBackendName(FftBackendType type);
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    FftResourceRegistry.cpp
+
+  ==============================================================================
+*/
+
+#include "FftResourceRegistry.h"
+#include <tuple>
+
+//==============================================================================
+bool FftResourceKey::operator<(const FftResourceKey& other) const {
+    return std::tie(kind, fftSize, precision, backend, window, hopSize, numChannels)
+         < std::tie(other.kind, other.fftSize, other.precision, other.backend, other.window, other.hopSize, other.numChannels);
+}
+
+//==============================================================================
+FftResourceRegistry& FftResourceRegistry::getInstance() {
+    // never destroyed, resources may be released from static destructors
+    // after this one would have run
+    static auto* registry = new FftResourceRegistry();
+    return *registry;
+}
+
+void FftResourceRegistry::removeExpiredEntries() {
+    for (auto entry = entries.begin(); entry != entries.end();) {
+        if (entry->second.resource.expired()) {
+            entry = entries.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+}
+
+FftResourceRegistry::Stats FftResourceRegistry::getStats() const {
+    std::lock_guard<std::mutex> lock(entriesLock);
+
+    Stats stats;
+    for (auto& entry : entries) {
+        const auto numHolders = (int) entry.second.resource.use_count();
+        if (numHolders == 0) {
+            continue;
+        }
+        stats.numEntries++;
+        stats.numReferences += numHolders;
+        stats.numBytes += entry.second.numBytes;
+        stats.numBytesShared += entry.second.numBytes * (numHolders - 1);
+    }
+    stats.numHits = numHits;
+    stats.numMisses = numMisses;
+    stats.secondsCreating = juce::Time::highResolutionTicksToSeconds(ticksCreating);
+    return stats;
+}
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    FftResourceRegistry.h
+
+    Process wide cache of the immutable parts of the stft engines: fftw
+    plans, juce::dsp::FFT objects, the radix backend's twiddle tables and
+    the analysis/synthesis window pairs. The first instance asking for a key builds the resource,
+    every later one gets the same object, so a session running many plugin
+    instances plans and stores every size only once. Per instance state
+    (frames, rings, transform scratch buffers) stays with the instances.
+
+    The registry only holds weak references. A resource lives as long as
+    some backend or engine holds it and is freed with the last one. Lookups
+    take a mutex and may build the resource, so they belong in prepare code,
+    never on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "FftBackend.h"
+#include "StftWindow.h"
+
+//==============================================================================
+enum class FftResourceKind
+{
+    fftwPlans,
+    juceFft,
+    radixTables,
+    windowPair
+};
+
+struct FftResourceKey
+{
+    FftResourceKind kind = FftResourceKind::windowPair;
+    int fftSize = 0;
+    // bytes per transform sample, 4 or 8. 0 where it doesn't apply.
+    int precision = 0;
+    FftBackendType backend = FftBackendType::automatic;
+    WindowType window = WindowType::hann;
+    // window pairs depend on the hop through their overlap-add gain, the
+    // batched fftw plans on the channel count. 0 where it doesn't apply.
+    int hopSize = 0;
+    int numChannels = 0;
+
+    bool operator<(const FftResourceKey& other) const;
+};
+
+//==============================================================================
+class FftResourceRegistry
+{
+public:
+    struct Stats
+    {
+        // resources alive and the holders sharing them
+        int numEntries = 0;
+        int numReferences = 0;
+        // memory of the live resources, and how much more it would take if
+        // every holder had its own copy
+        juce::int64 numBytes = 0;
+        juce::int64 numBytesShared = 0;
+        // lookups served by a live resource, and lookups that built one
+        juce::int64 numHits = 0;
+        juce::int64 numMisses = 0;
+        // total time spent building resources
+        double secondsCreating = 0.0;
+    };
+
+    static FftResourceRegistry& getInstance();
+
+    // returns the live resource for key, or builds it with create(), a
+    // callable returning std::shared_ptr<Resource> (nullptr if it failed,
+    // which is not cached). Resource reports its size with getNumBytes().
+    // the lock is held while building, so concurrent lookups of the same key
+    // wait for the first one instead of building it twice.
+    template <typename Resource, typename Create>
+    std::shared_ptr<const Resource> getOrCreate(const FftResourceKey& key, Create&& create) {
+        std::lock_guard<std::mutex> lock(entriesLock);
+        removeExpiredEntries();
+
+        auto existing = entries.find(key);
+        if (existing != entries.end()) {
+            if (auto resource = existing->second.resource.lock()) {
+                numHits++;
+                return std::static_pointer_cast<const Resource>(resource);
+            }
+        }
+
+        numMisses++;
+        const auto start = juce::Time::getHighResolutionTicks();
+        std::shared_ptr<const Resource> resource = create();
+        ticksCreating += juce::Time::getHighResolutionTicks() - start;
+        if (resource != nullptr) {
+            entries[key] = { resource, (juce::int64) resource->getNumBytes() };
+        }
+        return resource;
+    }
+
+    Stats getStats() const;
+
+private:
+    FftResourceRegistry() = default;
+
+    struct Entry
+    {
+        std::weak_ptr<const void> resource;
+        juce::int64 numBytes = 0;
+    };
+
+    void removeExpiredEntries();
+
+    mutable std::mutex entriesLock;
+    std::map<FftResourceKey, Entry> entries;
+    juce::int64 numHits = 0;
+    juce::int64 numMisses = 0;
+    juce::int64 ticksCreating = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (FftResourceRegistry)
+};
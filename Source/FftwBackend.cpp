@@ -0,0 +1,486 @@
+/*
+  ==============================================================================
+
+    FftwBackend.cpp
+
+  ==============================================================================
+*/
+
+#include "FftwBackend.h"
+#include "FftResourceRegistry.h"
+
+#if FFT_USE_FFTW
+
+//==============================================================================
+template <typename Precision>
+FftwBackend<Precision>::FftwBackend(unsigned plannerFlags)
+    : flags(plannerFlags)
+{
+}
+
+template <typename Precision>
+FftwBackend<Precision>::~FftwBackend()
+{
+    release();
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::prepare(int fftSize, int numChannels) {
+    if (isPrepared() && fftSize == size && numChannels == channels) {
+        return;
+    }
+    release();
+    size = fftSize;
+    channels = numChannels;
+
+    // allocate mem for the time and frequency domain buffers. fftw_malloc
+    // gives them the alignment the shared plans were made for.
+    timeData = (Precision*) Fftw::malloc(sizeof(Precision) * size);
+    freqData = (typename Fftw::Complex*) Fftw::malloc(sizeof(typename Fftw::Complex) * getNumBins());
+    if (channels > 1) {
+        batchTimeData = (Precision*) Fftw::malloc(sizeof(Precision) * size * channels);
+        batchFreqData = (typename Fftw::Complex*) Fftw::malloc(sizeof(typename Fftw::Complex) * getNumBins() * channels);
+    }
+    splitTimeData = (Precision*) Fftw::malloc(sizeof(Precision) * size * channels);
+    splitFreqData = (Precision*) Fftw::malloc(sizeof(Precision) * SpectralFrame::getChannelStride(size) * channels);
+    if (channels > 1) {
+        pairRe = (Precision*) Fftw::malloc(sizeof(Precision) * size);
+        pairIm = (Precision*) Fftw::malloc(sizeof(Precision) * size);
+    }
+
+    // plan both directions once per process, they are reused on every hop by
+    // every instance of this size
+    FftResourceKey key;
+    key.kind = FftResourceKind::fftwPlans;
+    key.fftSize = size;
+    key.precision = (int) sizeof(Precision);
+    key.backend = FftBackendType::fftw;
+    key.numChannels = channels;
+    plans = FftResourceRegistry::getInstance().getOrCreate<Plans>(key, [this] {
+        return createPlans(size, channels, flags);
+    });
+}
+
+template <typename Precision>
+std::shared_ptr<typename FftwBackend<Precision>::Plans> FftwBackend<Precision>::createPlans(int fftSize, int numChannels, unsigned plannerFlags) {
+    auto plans = std::make_shared<Plans>();
+    plans->size = fftSize;
+    plans->channels = numChannels;
+
+    // planning may overwrite its arrays, and the plans never run on them
+    // afterwards, so plan on scratch buffers laid out like the instances'
+    const int numBins = fftSize / 2 + 1;
+    auto* time = (Precision*) Fftw::malloc(sizeof(Precision) * fftSize);
+    auto* freq = (typename Fftw::Complex*) Fftw::malloc(sizeof(typename Fftw::Complex) * numBins);
+    auto* batchTime = (Precision*) Fftw::malloc(sizeof(Precision) * fftSize * numChannels);
+    auto* batchFreq = (typename Fftw::Complex*) Fftw::malloc(sizeof(typename Fftw::Complex) * numBins * numChannels);
+    auto* splitTime = (Precision*) Fftw::malloc(sizeof(Precision) * fftSize * numChannels);
+    auto* splitFreq = (Precision*) Fftw::malloc(sizeof(Precision) * SpectralFrame::getChannelStride(fftSize) * numChannels);
+    auto* pairRe = (Precision*) Fftw::malloc(sizeof(Precision) * fftSize);
+    auto* pairIm = (Precision*) Fftw::malloc(sizeof(Precision) * fftSize);
+
+    bool ok = false;
+    {
+        std::lock_guard<std::mutex> lock(getPlannerLock());
+       #if FFT_FFTW_USE_WISDOM
+        loadWisdom();
+
+        // try the stored wisdom first, only plan from scratch if it has
+        // nothing for this size
+        ok = makePlans(*plans, plannerFlags | FFTW_WISDOM_ONLY, time, freq, batchTime, batchFreq, splitTime, splitFreq, pairRe, pairIm);
+        if (! ok) {
+            ok = makePlans(*plans, plannerFlags, time, freq, batchTime, batchFreq, splitTime, splitFreq, pairRe, pairIm);
+            saveWisdom();
+        }
+       #else
+        ok = makePlans(*plans, plannerFlags, time, freq, batchTime, batchFreq, splitTime, splitFreq, pairRe, pairIm);
+       #endif
+    }
+
+    for (void* buffer : { (void*) time, (void*) freq, (void*) batchTime, (void*) batchFreq, (void*) splitTime, (void*) splitFreq,
+                          (void*) pairRe, (void*) pairIm }) {
+        Fftw::free(buffer);
+    }
+    return ok ? plans : nullptr;
+}
+
+template <typename Precision>
+bool FftwBackend<Precision>::makePlans(Plans& plans, unsigned planFlags, Precision* time, typename Fftw::Complex* freq,
+                                       Precision* batchTime, typename Fftw::Complex* batchFreq, Precision* splitTime, Precision* splitFreq,
+                                       Precision* pairRe, Precision* pairIm) {
+    const int size = plans.size;
+    const int channels = plans.channels;
+
+    plans.forward = Fftw::planR2c(size, time, freq, planFlags);
+    plans.inverse = Fftw::planC2r(size, freq, time, planFlags);
+    bool ok = plans.forward != nullptr && plans.inverse != nullptr;
+
+    if (channels > 1) {
+        plans.forwardBatch = Fftw::planManyR2c(size, channels, batchTime, batchFreq, planFlags);
+        plans.inverseBatch = Fftw::planManyC2r(size, channels, batchFreq, batchTime, planFlags);
+        ok = ok && plans.forwardBatch != nullptr && plans.inverseBatch != nullptr;
+    }
+
+    // the single channel split plans work on the first frame of the split buffers
+    const int binStride = SpectralFrame::getChannelStride(size);
+    Precision* splitRe = splitFreq;
+    Precision* splitIm = splitFreq + SpectralFrame::getPaddedNumBins(size);
+    plans.forwardSplit = Fftw::planSplitR2c(size, 1, binStride, splitTime, splitRe, splitIm, planFlags);
+    plans.inverseSplit = Fftw::planSplitC2r(size, 1, binStride, splitRe, splitIm, splitTime, planFlags);
+    ok = ok && plans.forwardSplit != nullptr && plans.inverseSplit != nullptr;
+    if (channels > 1) {
+        plans.forwardSplitBatch = Fftw::planSplitR2c(size, channels, binStride, splitTime, splitRe, splitIm, planFlags);
+        plans.inverseSplitBatch = Fftw::planSplitC2r(size, channels, binStride, splitRe, splitIm, splitTime, planFlags);
+        ok = ok && plans.forwardSplitBatch != nullptr && plans.inverseSplitBatch != nullptr;
+
+        // both channels as one complex signal, read from the split frames
+        plans.pair = Fftw::planSplitDft(size, splitTime, splitTime + size, pairRe, pairIm, planFlags);
+        ok = ok && plans.pair != nullptr;
+    }
+
+    // leave none behind if any failed
+    if (! ok) {
+        plans.destroyPlans();
+    }
+    return ok;
+}
+
+template <typename Precision>
+FftwBackend<Precision>::Plans::~Plans() {
+    // fftw_destroy_plan goes through the planner too
+    std::lock_guard<std::mutex> lock(getPlannerLock());
+    destroyPlans();
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::Plans::destroyPlans() {
+    for (auto* plan : { &forward, &inverse, &forwardBatch, &inverseBatch,
+                        &forwardSplit, &inverseSplit, &forwardSplitBatch, &inverseSplitBatch, &pair }) {
+        if (*plan != nullptr) {
+            Fftw::destroy(*plan);
+            *plan = nullptr;
+        }
+    }
+}
+
+template <typename Precision>
+size_t FftwBackend<Precision>::Plans::getNumBytes() const {
+    const size_t numPlans = channels > 1 ? 9 : 4;
+    return sizeof(typename Fftw::Complex) * (size_t) size * numPlans;
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::release() {
+    plans = nullptr;
+    Fftw::free(timeData);
+    Fftw::free(freqData);
+    Fftw::free(batchTimeData);
+    Fftw::free(batchFreqData);
+    Fftw::free(splitTimeData);
+    Fftw::free(splitFreqData);
+    Fftw::free(pairRe);
+    Fftw::free(pairIm);
+    timeData = nullptr;
+    freqData = nullptr;
+    batchTimeData = nullptr;
+    batchFreqData = nullptr;
+    splitTimeData = nullptr;
+    splitFreqData = nullptr;
+    pairRe = nullptr;
+    pairIm = nullptr;
+    size = 0;
+    channels = 0;
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::forward(const float* input, std::complex<float>* output) {
+    jassert(isPrepared());
+
+    copyToTimeData(timeData, input, size);
+    Fftw::executeR2c(plans->forward, timeData, freqData);
+    copyFromFreqData(output, freqData, getNumBins());
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::inverse(const std::complex<float>* input, float* output) {
+    jassert(isPrepared());
+
+    // c2r overwrites its input, so the copy is needed anyway
+    copyToFreqData(freqData, input, getNumBins());
+    Fftw::executeC2r(plans->inverse, freqData, timeData);
+    copyFromTimeData(output, timeData, size);
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::forwardBatch(const float* input, std::complex<float>* output, int numChannels) {
+    if (numChannels != channels || plans->forwardBatch == nullptr) {
+        FftBackend::forwardBatch(input, output, numChannels);
+        return;
+    }
+
+    copyToTimeData(batchTimeData, input, size * channels);
+    Fftw::executeR2c(plans->forwardBatch, batchTimeData, batchFreqData);
+    copyFromFreqData(output, batchFreqData, getNumBins() * channels);
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::inverseBatch(const std::complex<float>* input, float* output, int numChannels) {
+    if (numChannels != channels || plans->inverseBatch == nullptr) {
+        FftBackend::inverseBatch(input, output, numChannels);
+        return;
+    }
+
+    copyToFreqData(batchFreqData, input, getNumBins() * channels);
+    Fftw::executeC2r(plans->inverseBatch, batchFreqData, batchTimeData);
+    copyFromTimeData(output, batchTimeData, size * channels);
+}
+
+template <typename Precision>
+bool FftwBackend<Precision>::canExecuteSplitOn(const float* time, const float* real, const float* imag, int binStride) const {
+    if constexpr (std::is_same<Precision, float>::value) {
+        // new-array execution needs the planned strides and the same simd
+        // alignment as the planned arrays
+        const int padded = SpectralFrame::getPaddedNumBins(size);
+        return binStride == SpectralFrame::getChannelStride(size) && imag == real + padded
+            && Fftw::alignmentOf(const_cast<float*>(time)) == Fftw::alignmentOf(splitTimeData)
+            && Fftw::alignmentOf(const_cast<float*>(real)) == Fftw::alignmentOf(splitFreqData)
+            && Fftw::alignmentOf(const_cast<float*>(imag)) == Fftw::alignmentOf(splitFreqData + padded);
+    } else {
+        juce::ignoreUnused(time, real, imag, binStride);
+        return false;
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) {
+    jassert(isPrepared());
+
+    const bool batched = numChannels == channels && (channels == 1 || plans->forwardSplitBatch != nullptr);
+    const auto plan = batched && channels > 1 ? plans->forwardSplitBatch : plans->forwardSplit;
+
+    if constexpr (std::is_same<Precision, float>::value) {
+        if (canExecuteSplitOn(input, real, imag, binStride)) {
+            // r2c leaves its input alone, the const_cast is only for the api
+            if (batched) {
+                Fftw::executeSplitR2c(plan, const_cast<float*>(input), real, imag);
+            } else {
+                for (int ch=0; ch<numChannels; ch++) {
+                    Fftw::executeSplitR2c(plan, const_cast<float*>(input) + ch * size, real + ch * binStride, imag + ch * binStride);
+                }
+            }
+            return;
+        }
+    }
+
+    if (batched) {
+        copyToTimeData(splitTimeData, input, size * channels);
+        Fftw::executeSplitR2c(plan, splitTimeData, splitFreqData, splitFreqData + SpectralFrame::getPaddedNumBins(size));
+        copyFromSplitData(real, imag, channels, binStride);
+        return;
+    }
+
+    for (int ch=0; ch<numChannels; ch++) {
+        copyToTimeData(splitTimeData, input + ch * size, size);
+        Fftw::executeSplitR2c(plan, splitTimeData, splitFreqData, splitFreqData + SpectralFrame::getPaddedNumBins(size));
+        copyFromSplitData(real + ch * binStride, imag + ch * binStride, 1, binStride);
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) {
+    jassert(isPrepared());
+
+    const bool batched = numChannels == channels && (channels == 1 || plans->inverseSplitBatch != nullptr);
+    const auto plan = batched && channels > 1 ? plans->inverseSplitBatch : plans->inverseSplit;
+
+    if constexpr (std::is_same<Precision, float>::value) {
+        if (canExecuteSplitOn(output, real, imag, binStride)) {
+            if (batched) {
+                Fftw::executeSplitC2r(plan, real, imag, output);
+            } else {
+                for (int ch=0; ch<numChannels; ch++) {
+                    Fftw::executeSplitC2r(plan, real + ch * binStride, imag + ch * binStride, output + ch * size);
+                }
+            }
+            return;
+        }
+    }
+
+    // c2r overwrites its input, so the copy is needed anyway
+    if (batched) {
+        copyToSplitData(real, imag, channels, binStride);
+        Fftw::executeSplitC2r(plan, splitFreqData, splitFreqData + SpectralFrame::getPaddedNumBins(size), splitTimeData);
+        copyFromTimeData(output, splitTimeData, size * channels);
+        return;
+    }
+
+    for (int ch=0; ch<numChannels; ch++) {
+        copyToSplitData(real + ch * binStride, imag + ch * binStride, 1, binStride);
+        Fftw::executeSplitC2r(plan, splitFreqData, splitFreqData + SpectralFrame::getPaddedNumBins(size), splitTimeData);
+        copyFromTimeData(output + ch * size, splitTimeData, size);
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::forwardPair(const float* input, float* real, float* imag, int binStride) {
+    jassert(isPrepared());
+
+    // separatePair works on floats, double precision builds run two real
+    // transforms instead
+    if constexpr (std::is_same<Precision, float>::value) {
+        if (plans->pair != nullptr) {
+            const float* first = input;
+            if (Fftw::alignmentOf(const_cast<float*>(input)) != Fftw::alignmentOf(splitTimeData)
+                || Fftw::alignmentOf(const_cast<float*>(input) + size) != Fftw::alignmentOf(splitTimeData + size)) {
+                copyToTimeData(splitTimeData, input, 2 * size);
+                first = splitTimeData;
+            }
+            // a complex transform leaves its input alone
+            Fftw::executeSplitDft(plans->pair, const_cast<float*>(first), const_cast<float*>(first) + size, pairRe, pairIm);
+            separatePair(pairRe, pairIm, 1, size, real, imag, binStride);
+            return;
+        }
+    }
+    FftBackend::forwardPair(input, real, imag, binStride);
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::inversePair(float* real, float* imag, float* output, int binStride) {
+    jassert(isPrepared());
+
+    if constexpr (std::is_same<Precision, float>::value) {
+        if (plans->pair != nullptr) {
+            // the inverse of Z is the forward transform with real and
+            // imaginary parts swapped on the way in and out
+            combinePair(real, imag, binStride, size, pairRe, pairIm, 1);
+            if (Fftw::alignmentOf(output) == Fftw::alignmentOf(pairRe)
+                && Fftw::alignmentOf(output + size) == Fftw::alignmentOf(pairIm)) {
+                Fftw::executeSplitDft(plans->pair, pairIm, pairRe, output + size, output);
+            } else {
+                Fftw::executeSplitDft(plans->pair, pairIm, pairRe, splitTimeData + size, splitTimeData);
+                copyFromTimeData(output, splitTimeData, 2 * size);
+            }
+            return;
+        }
+    }
+    FftBackend::inversePair(real, imag, output, binStride);
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::copyToSplitData(const float* real, const float* imag, int numChannels, int binStride) {
+    const int stride = SpectralFrame::getChannelStride(size);
+    const int padded = SpectralFrame::getPaddedNumBins(size);
+    for (int ch=0; ch<numChannels; ch++) {
+        copyToTimeData(splitFreqData + ch * stride, real + ch * binStride, getNumBins());
+        copyToTimeData(splitFreqData + ch * stride + padded, imag + ch * binStride, getNumBins());
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::copyFromSplitData(float* real, float* imag, int numChannels, int binStride) {
+    const int stride = SpectralFrame::getChannelStride(size);
+    const int padded = SpectralFrame::getPaddedNumBins(size);
+    for (int ch=0; ch<numChannels; ch++) {
+        copyFromTimeData(real + ch * binStride, splitFreqData + ch * stride, getNumBins());
+        copyFromTimeData(imag + ch * binStride, splitFreqData + ch * stride + padded, getNumBins());
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::copyToTimeData(Precision* dest, const float* src, int num) {
+    bytesCopied += (juce::int64) (sizeof(Precision) * (size_t) num);
+    if constexpr (std::is_same<Precision, float>::value) {
+        std::memcpy(dest, src, sizeof(float) * (size_t) num);
+    } else {
+        for (int i=0; i<num; i++) {
+            dest[i] = (Precision) src[i];
+        }
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::copyFromTimeData(float* dest, const Precision* src, int num) {
+    bytesCopied += (juce::int64) (sizeof(float) * (size_t) num);
+    if constexpr (std::is_same<Precision, float>::value) {
+        std::memcpy(dest, src, sizeof(float) * (size_t) num);
+    } else {
+        for (int i=0; i<num; i++) {
+            dest[i] = (float) src[i];
+        }
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::copyToFreqData(typename Fftw::Complex* dest, const std::complex<float>* src, int num) {
+    bytesCopied += (juce::int64) (sizeof(typename Fftw::Complex) * (size_t) num);
+    // fftwf_complex has the same layout as std::complex<float>
+    if constexpr (std::is_same<Precision, float>::value) {
+        std::memcpy((void*) dest, src, sizeof(std::complex<float>) * (size_t) num);
+    } else {
+        for (int i=0; i<num; i++) {
+            dest[i][0] = src[i].real();
+            dest[i][1] = src[i].imag();
+        }
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::copyFromFreqData(std::complex<float>* dest, const typename Fftw::Complex* src, int num) {
+    bytesCopied += (juce::int64) (sizeof(std::complex<float>) * (size_t) num);
+    if constexpr (std::is_same<Precision, float>::value) {
+        std::memcpy((void*) dest, src, sizeof(std::complex<float>) * (size_t) num);
+    } else {
+        for (int i=0; i<num; i++) {
+            dest[i] = { (float) src[i][0], (float) src[i][1] };
+        }
+    }
+}
+
+template <typename Precision>
+juce::File FftwBackend<Precision>::getWisdomFile() {
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile("FftPassthrough")
+               .getChildFile(Fftw::getWisdomFileName());
+}
+
+template <typename Precision>
+std::mutex& FftwBackend<Precision>::getPlannerLock() {
+    static std::mutex plannerLock;
+    return plannerLock;
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::loadWisdom() {
+    static bool loaded = false;
+    if (loaded) {
+        return;
+    }
+    loaded = true;
+
+    auto file = getWisdomFile();
+    if (file.existsAsFile() && ! Fftw::importWisdom(file.getFullPathName().toRawUTF8())) {
+        DBG("could not read fftw wisdom from " << file.getFullPathName());
+    }
+}
+
+template <typename Precision>
+void FftwBackend<Precision>::saveWisdom() {
+    auto file = getWisdomFile();
+    if (! file.getParentDirectory().createDirectory()) {
+        return;
+    }
+
+    // write next to the target and swap it in, so other processes never
+    // read a half written file
+    juce::TemporaryFile temp(file);
+    if (Fftw::exportWisdom(temp.getFile().getFullPathName().toRawUTF8())) {
+        temp.overwriteTargetFileWithTemporary();
+    }
+}
+
+//==============================================================================
+// only the configured precision is instantiated, so only its fftw library
+// has to be linked
+template class FftwBackend<FftPrecision>;
+
+#endif // FFT_USE_FFTW
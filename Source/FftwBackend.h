@@ -0,0 +1,255 @@
+/*
+  ==============================================================================
+
+    FftwBackend.h
+
+    fftw implementation of FftBackend. Owns the aligned transform buffers
+    and shares its plans with every other instance of the same size (see
+    FftResourceRegistry). Everything is allocated and planned in prepare(),
+    so forward() and inverse() can be called from the audio thread without
+    touching the heap or the fftw planner.
+
+    The backend is templated on the transform precision: FftwBackend<float>
+    uses the fftwf_ api (libfftw3f), FftwBackend<double> the fftw_ api
+    (libfftw3).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "FftBackend.h"
+#include "SpectralFrame.h"
+
+#if FFT_USE_FFTW
+
+#include <fftw3.h>
+#include <mutex>
+
+// transform precision. single precision (fftwf_, libfftw3f) by default, it
+// is 1.5 to 2 times as fast as double with an error around 1e-7 of the
+// signal. build with FFT_DOUBLE_PRECISION=1 for the fftw_ api and the
+// libfftw3 in Libraries.
+#ifndef FFT_DOUBLE_PRECISION
+ #define FFT_DOUBLE_PRECISION 0
+#endif
+
+#if FFT_DOUBLE_PRECISION
+using FftPrecision = double;
+#else
+using FftPrecision = float;
+#endif
+
+// planner rigor. FFTW_MEASURE or FFTW_PATIENT find faster plans but take a
+// while to plan, which is only paid once per machine when wisdom is enabled.
+#ifndef FFT_FFTW_PLANNER_FLAGS
+ #define FFT_FFTW_PLANNER_FLAGS FFTW_MEASURE
+#endif
+
+// load fftw wisdom from disk before planning and store it after new plans
+// have been made
+#ifndef FFT_FFTW_USE_WISDOM
+ #define FFT_FFTW_USE_WISDOM 1
+#endif
+
+//==============================================================================
+// maps a sample type to the matching fftw api
+template <typename Precision>
+struct FftwTraits;
+
+template <>
+struct FftwTraits<float>
+{
+    using Complex = fftwf_complex;
+    using Plan = fftwf_plan;
+
+    static void* malloc(size_t n) { return fftwf_malloc(n); }
+    static void free(void* p) { fftwf_free(p); }
+    static Plan planR2c(int n, float* in, Complex* out, unsigned flags) { return fftwf_plan_dft_r2c_1d(n, in, out, flags); }
+    static Plan planC2r(int n, Complex* in, float* out, unsigned flags) { return fftwf_plan_dft_c2r_1d(n, in, out, flags); }
+    static Plan planManyR2c(int n, int howMany, float* in, Complex* out, unsigned flags) { return fftwf_plan_many_dft_r2c(1, &n, howMany, in, nullptr, 1, n, out, nullptr, 1, n / 2 + 1, flags); }
+    static Plan planManyC2r(int n, int howMany, Complex* in, float* out, unsigned flags) { return fftwf_plan_many_dft_c2r(1, &n, howMany, in, nullptr, 1, n / 2 + 1, out, nullptr, 1, n, flags); }
+    static Plan planSplitR2c(int n, int howMany, int binStride, float* in, float* re, float* im, unsigned flags) {
+        fftwf_iodim dim { n, 1, 1 }, batch { howMany, n, binStride };
+        return fftwf_plan_guru_split_dft_r2c(1, &dim, 1, &batch, in, re, im, flags);
+    }
+    static Plan planSplitC2r(int n, int howMany, int binStride, float* re, float* im, float* out, unsigned flags) {
+        fftwf_iodim dim { n, 1, 1 }, batch { howMany, binStride, n };
+        return fftwf_plan_guru_split_dft_c2r(1, &dim, 1, &batch, re, im, out, flags);
+    }
+    static Plan planSplitDft(int n, float* ri, float* ii, float* ro, float* io, unsigned flags) {
+        fftwf_iodim dim { n, 1, 1 };
+        return fftwf_plan_guru_split_dft(1, &dim, 0, nullptr, ri, ii, ro, io, flags);
+    }
+    // new-array execution, on buffers with the layout and alignment planned.
+    // plans are only ever run this way, so one plan can serve every instance.
+    static void executeSplitR2c(const Plan p, float* in, float* re, float* im) { fftwf_execute_split_dft_r2c(p, in, re, im); }
+    static void executeSplitC2r(const Plan p, float* re, float* im, float* out) { fftwf_execute_split_dft_c2r(p, re, im, out); }
+    static void executeR2c(const Plan p, float* in, Complex* out) { fftwf_execute_dft_r2c(p, in, out); }
+    static void executeC2r(const Plan p, Complex* in, float* out) { fftwf_execute_dft_c2r(p, in, out); }
+    static void executeSplitDft(const Plan p, float* ri, float* ii, float* ro, float* io) { fftwf_execute_split_dft(p, ri, ii, ro, io); }
+    static int alignmentOf(float* p) { return fftwf_alignment_of(p); }
+    static void destroy(Plan p) { fftwf_destroy_plan(p); }
+    static bool importWisdom(const char* path) { return fftwf_import_wisdom_from_filename(path) != 0; }
+    static bool exportWisdom(const char* path) { return fftwf_export_wisdom_to_filename(path) != 0; }
+    static const char* getWisdomFileName() { return "fftwf_wisdom"; }
+};
+
+template <>
+struct FftwTraits<double>
+{
+    using Complex = fftw_complex;
+    using Plan = fftw_plan;
+
+    static void* malloc(size_t n) { return fftw_malloc(n); }
+    static void free(void* p) { fftw_free(p); }
+    static Plan planR2c(int n, double* in, Complex* out, unsigned flags) { return fftw_plan_dft_r2c_1d(n, in, out, flags); }
+    static Plan planC2r(int n, Complex* in, double* out, unsigned flags) { return fftw_plan_dft_c2r_1d(n, in, out, flags); }
+    static Plan planManyR2c(int n, int howMany, double* in, Complex* out, unsigned flags) { return fftw_plan_many_dft_r2c(1, &n, howMany, in, nullptr, 1, n, out, nullptr, 1, n / 2 + 1, flags); }
+    static Plan planManyC2r(int n, int howMany, Complex* in, double* out, unsigned flags) { return fftw_plan_many_dft_c2r(1, &n, howMany, in, nullptr, 1, n / 2 + 1, out, nullptr, 1, n, flags); }
+    static Plan planSplitR2c(int n, int howMany, int binStride, double* in, double* re, double* im, unsigned flags) {
+        fftw_iodim dim { n, 1, 1 }, batch { howMany, n, binStride };
+        return fftw_plan_guru_split_dft_r2c(1, &dim, 1, &batch, in, re, im, flags);
+    }
+    static Plan planSplitC2r(int n, int howMany, int binStride, double* re, double* im, double* out, unsigned flags) {
+        fftw_iodim dim { n, 1, 1 }, batch { howMany, binStride, n };
+        return fftw_plan_guru_split_dft_c2r(1, &dim, 1, &batch, re, im, out, flags);
+    }
+    static Plan planSplitDft(int n, double* ri, double* ii, double* ro, double* io, unsigned flags) {
+        fftw_iodim dim { n, 1, 1 };
+        return fftw_plan_guru_split_dft(1, &dim, 0, nullptr, ri, ii, ro, io, flags);
+    }
+    static void executeSplitR2c(const Plan p, double* in, double* re, double* im) { fftw_execute_split_dft_r2c(p, in, re, im); }
+    static void executeSplitC2r(const Plan p, double* re, double* im, double* out) { fftw_execute_split_dft_c2r(p, re, im, out); }
+    static void executeR2c(const Plan p, double* in, Complex* out) { fftw_execute_dft_r2c(p, in, out); }
+    static void executeC2r(const Plan p, Complex* in, double* out) { fftw_execute_dft_c2r(p, in, out); }
+    static void executeSplitDft(const Plan p, double* ri, double* ii, double* ro, double* io) { fftw_execute_split_dft(p, ri, ii, ro, io); }
+    static int alignmentOf(double* p) { return fftw_alignment_of(p); }
+    static void destroy(Plan p) { fftw_destroy_plan(p); }
+    static bool importWisdom(const char* path) { return fftw_import_wisdom_from_filename(path) != 0; }
+    static bool exportWisdom(const char* path) { return fftw_export_wisdom_to_filename(path) != 0; }
+    static const char* getWisdomFileName() { return "fftw_wisdom"; }
+};
+
+//==============================================================================
+template <typename Precision>
+class FftwBackend : public FftBackend
+{
+public:
+    using Fftw = FftwTraits<Precision>;
+
+    explicit FftwBackend(unsigned plannerFlags = FFT_FFTW_PLANNER_FLAGS);
+    ~FftwBackend() override;
+
+    const char* getName() const override { return "fftw"; }
+
+    void prepare(int fftSize, int numChannels) override;
+    void release() override;
+
+    bool isPrepared() const override { return plans != nullptr; }
+    int getSize() const override { return size; }
+    int getNumChannels() const override { return channels; }
+
+    void forward(const float* input, std::complex<float>* output) override;
+    void inverse(const std::complex<float>* input, float* output) override;
+    // runs all channels through a single plan_many transform
+    void forwardBatch(const float* input, std::complex<float>* output, int numChannels) override;
+    void inverseBatch(const std::complex<float>* input, float* output, int numChannels) override;
+    // split transforms run on guru split plans laid out like a SpectralFrame,
+    // all channels at once when numChannels matches the prepared count. in
+    // single precision they execute straight on the caller's buffers when
+    // those have the planned layout and alignment, nothing is copied then.
+    void forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) override;
+    void inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) override;
+    // a split complex plan with the two frames as its real and imaginary
+    // input. the inverse runs the same plan with real and imaginary parts
+    // swapped. in single precision the frames are used in place when they
+    // have the planned alignment.
+    void forwardPair(const float* input, float* real, float* imag, int binStride) override;
+    void inversePair(float* real, float* imag, float* output, int binStride) override;
+
+    // where wisdom for this precision is kept, shared by every instance
+    static juce::File getWisdomFile();
+
+private:
+    // the fftw planner is not thread safe, every instance plans under this lock
+    static std::mutex& getPlannerLock();
+    // imports the wisdom file the first time it's called in this process
+    static void loadWisdom();
+    static void saveWisdom();
+
+    // every plan for one size, precision and channel count. plans are
+    // immutable once made and only run through new-array execution on the
+    // instance's own buffers, so they are shared through FftResourceRegistry
+    // by all backends with the same key.
+    struct Plans
+    {
+        ~Plans();
+        // destroys the plans made so far, with the planner lock held
+        void destroyPlans();
+        // fftw doesn't report what a plan holds, counted as one complex
+        // twiddle per sample and plan
+        size_t getNumBytes() const;
+
+        int size = 0;
+        int channels = 0;
+        typename Fftw::Plan forward = nullptr;
+        typename Fftw::Plan inverse = nullptr;
+        typename Fftw::Plan forwardBatch = nullptr;
+        typename Fftw::Plan inverseBatch = nullptr;
+        typename Fftw::Plan forwardSplit = nullptr;
+        typename Fftw::Plan inverseSplit = nullptr;
+        typename Fftw::Plan forwardSplitBatch = nullptr;
+        typename Fftw::Plan inverseSplitBatch = nullptr;
+        // complex transform of size points, made when channels > 1
+        typename Fftw::Plan pair = nullptr;
+    };
+
+    // plans on scratch buffers with the layout of this backend's own, using
+    // the stored wisdom when it has the size. nullptr if any plan failed.
+    static std::shared_ptr<Plans> createPlans(int fftSize, int numChannels, unsigned plannerFlags);
+    // makes every plan with planFlags, returns false if any failed
+    static bool makePlans(Plans& plans, unsigned planFlags, Precision* time, typename Fftw::Complex* freq,
+                          Precision* batchTime, typename Fftw::Complex* batchFreq, Precision* splitTime, Precision* splitFreq,
+                          Precision* pairRe, Precision* pairIm);
+
+    // true if the split plans can run on these buffers directly
+    bool canExecuteSplitOn(const float* time, const float* real, const float* imag, int binStride) const;
+
+    // real <-> complex copies between the caller's float data and the
+    // buffers the plans run on, plain memcpys in single precision. they all add to bytesCopied.
+    void copyToTimeData(Precision* dest, const float* src, int num);
+    void copyFromTimeData(float* dest, const Precision* src, int num);
+    void copyToFreqData(typename Fftw::Complex* dest, const std::complex<float>* src, int num);
+    void copyFromFreqData(std::complex<float>* dest, const typename Fftw::Complex* src, int num);
+    // split bins between the caller's arrays and splitFreqData, per channel
+    void copyToSplitData(const float* real, const float* imag, int numChannels, int binStride);
+    void copyFromSplitData(float* real, float* imag, int numChannels, int binStride);
+
+    unsigned flags;
+    int size = 0;
+    int channels = 0;
+
+    Precision* timeData = nullptr;
+    typename Fftw::Complex* freqData = nullptr;
+
+    // one frame per channel, stored one after the other
+    Precision* batchTimeData = nullptr;
+    typename Fftw::Complex* batchFreqData = nullptr;
+
+    // split layout: channels frames in splitTimeData, and their bins in
+    // splitFreqData with the layout of a SpectralFrame (real parts, then
+    // imaginary parts, SpectralFrame::getChannelStride(size) per channel)
+    Precision* splitTimeData = nullptr;
+    Precision* splitFreqData = nullptr;
+
+    // pair transforms: the complex spectrum of both channels, size points
+    Precision* pairRe = nullptr;
+    Precision* pairIm = nullptr;
+
+    std::shared_ptr<const Plans> plans;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FftwBackend)
+};
+
+#endif // FFT_USE_FFTW
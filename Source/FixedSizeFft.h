@@ -0,0 +1,247 @@
+/*
+  ==============================================================================
+
+    FixedSizeFft.h
+
+    Header-only real FFTs for the power of two sizes 64 to 8192, each one a
+    separate template instantiation. Like RadixFftBackend, a real transform
+    of size N runs as a complex transform of N/2 points plus a split step,
+    on separate real and imaginary arrays. Here though every table is a
+    constexpr array built by the compiler, and the butterfly passes are
+    unrolled at compile time: each pass is its own function with a constant
+    span and group count, two radix-2 stages per pass (radix-2^2, three
+    complex multiplies per four points instead of four).
+
+    The kernels are compiled once per instruction set, SSE2, AVX2 and
+    AVX-512 on x86 and NEON on ARM, plus plain C++, by including
+    FixedSizeFftKernels.h in one namespace per instruction set with that
+    target enabled for the functions in it (see SimdOps.h). getKernels()
+    picks the widest one the cpu runs at run time. Nothing here allocates;
+    the caller provides the scratch buffers.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SimdOps.h"
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+namespace fixedfft
+{
+
+//==============================================================================
+using simd::Isa;
+using simd::getIsaName;
+using simd::isAvailable;
+using simd::getBestIsa;
+
+constexpr int minSize = 64;
+constexpr int maxSize = 8192;
+
+inline bool isSupportedSize(int size) {
+    return size >= minSize && size <= maxSize && (size & (size - 1)) == 0;
+}
+
+// floats of scratch a transform of size needs, at least 16 byte aligned
+constexpr int getWorkSize(int size) { return 2 * size; }
+
+//==============================================================================
+namespace detail
+{
+    constexpr double pi = 3.141592653589793238462643383279502884;
+
+    // taylor series, exact to double rounding over [-pi, pi]. std::sin and
+    // std::cos aren't constexpr.
+    constexpr double sinPi(double x) {
+        double term = x, sum = x;
+        for (int n=1; n<18; n++) {
+            term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double cosPi(double x) {
+        double term = 1.0, sum = 1.0;
+        for (int n=1; n<18; n++) {
+            term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+            sum += term;
+        }
+        return sum;
+    }
+
+    template <int Count>
+    struct TwiddleTable
+    {
+        alignas(64) std::array<float, Count> re {};
+        alignas(64) std::array<float, Count> im {};
+    };
+
+    // exp(-2 pi i k / n) for k in [0, Count), Count <= n / 2
+    template <int Count>
+    constexpr TwiddleTable<Count> makeTwiddles(int n) {
+        TwiddleTable<Count> table;
+        for (int k=0; k<Count; k++) {
+            const double angle = -2.0 * pi * k / n;
+            table.re[(size_t) k] = (float) cosPi(angle);
+            table.im[(size_t) k] = (float) sinPi(angle);
+        }
+        return table;
+    }
+
+    // a radix-2^2 pass does the stages of half span H and 2H at once, it
+    // needs the twiddles of both. a radix-2 pass only the first ones.
+    template <int H>
+    struct PassTwiddles
+    {
+        static constexpr TwiddleTable<H> first = makeTwiddles<H>(2 * H);
+        static constexpr TwiddleTable<H> second = makeTwiddles<H>(4 * H);
+    };
+
+    // the split step of a real transform of size N
+    template <int N>
+    struct SplitTwiddles
+    {
+        static constexpr TwiddleTable<N / 2> value = makeTwiddles<N / 2>(N);
+    };
+
+    template <int M>
+    constexpr std::array<std::uint16_t, M> makeBitReverse() {
+        int numBits = 0;
+        while ((1 << numBits) < M) {
+            numBits++;
+        }
+        std::array<std::uint16_t, M> table {};
+        for (int i=0; i<M; i++) {
+            int r = 0;
+            for (int b=0; b<numBits; b++) {
+                r |= ((i >> b) & 1) << (numBits - 1 - b);
+            }
+            table[(size_t) i] = (std::uint16_t) r;
+        }
+        return table;
+    }
+
+    template <int M>
+    struct BitReverse
+    {
+        static constexpr std::array<std::uint16_t, M> value = makeBitReverse<M>();
+    };
+}
+
+//==============================================================================
+// the kernels, once per instruction set with the vector types of SimdOps.h.
+// the passes use the widest of Wide and Quad that fits.
+namespace scalar
+{
+    using simd::scalar::Wide;
+    using simd::scalar::Quad;
+    #include "FixedSizeFftKernels.h"
+}
+
+#if SIMD_X86
+
+SIMD_BEGIN_TARGET_SSE2
+namespace sse2
+{
+    using simd::sse2::Wide;
+    using simd::sse2::Quad;
+    #include "FixedSizeFftKernels.h"
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_TARGET_AVX2
+namespace avx2
+{
+    using simd::avx2::Wide;
+    using simd::avx2::Quad;
+    #include "FixedSizeFftKernels.h"
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_TARGET_AVX512
+namespace avx512
+{
+    using simd::avx512::Wide;
+    using simd::avx512::Quad;
+    #include "FixedSizeFftKernels.h"
+}
+SIMD_END_TARGET
+
+#endif // SIMD_X86
+
+#if SIMD_NEON
+namespace neon
+{
+    using simd::neon::Wide;
+    using simd::neon::Quad;
+    #include "FixedSizeFftKernels.h"
+}
+#endif // SIMD_NEON
+
+//==============================================================================
+// the forward and inverse transform of one size for one instruction set.
+// forward: size real samples -> size/2+1 split bins, inverse: back again,
+// unscaled like fftw. inverse leaves its input bins alone.
+struct Kernels
+{
+    using Forward = void (*)(const float* input, float* real, float* imag, float* work);
+    using Inverse = void (*)(const float* real, const float* imag, float* output, float* work);
+
+    int size = 0;
+    Isa isa = Isa::scalar;
+    Forward forward = nullptr;
+    Inverse inverse = nullptr;
+
+    bool isValid() const { return forward != nullptr; }
+};
+
+namespace detail
+{
+    template <int N>
+    Kernels makeKernels(Isa isa) {
+        Kernels kernels;
+        kernels.size = N;
+        kernels.isa = isa;
+        switch (isa) {
+           #if SIMD_X86
+            case Isa::sse2:   kernels.forward = &sse2::forward<N>;   kernels.inverse = &sse2::inverse<N>;   return kernels;
+            case Isa::avx2:   kernels.forward = &avx2::forward<N>;   kernels.inverse = &avx2::inverse<N>;   return kernels;
+            case Isa::avx512: kernels.forward = &avx512::forward<N>; kernels.inverse = &avx512::inverse<N>; return kernels;
+           #endif
+           #if SIMD_NEON
+            case Isa::neon:   kernels.forward = &neon::forward<N>;   kernels.inverse = &neon::inverse<N>;   return kernels;
+           #endif
+            default: break;
+        }
+        kernels.isa = Isa::scalar;
+        kernels.forward = &scalar::forward<N>;
+        kernels.inverse = &scalar::inverse<N>;
+        return kernels;
+    }
+}
+
+// the kernels for size on isa, falling back to the scalar ones if the cpu
+// can't run isa. invalid for sizes outside [minSize, maxSize].
+inline Kernels getKernels(int size, Isa isa = getBestIsa()) {
+    if (! isAvailable(isa)) {
+        isa = Isa::scalar;
+    }
+    switch (size) {
+        case 64:   return detail::makeKernels<64>(isa);
+        case 128:  return detail::makeKernels<128>(isa);
+        case 256:  return detail::makeKernels<256>(isa);
+        case 512:  return detail::makeKernels<512>(isa);
+        case 1024: return detail::makeKernels<1024>(isa);
+        case 2048: return detail::makeKernels<2048>(isa);
+        case 4096: return detail::makeKernels<4096>(isa);
+        case 8192: return detail::makeKernels<8192>(isa);
+        default: break;
+    }
+    return {};
+}
+
+} // namespace fixedfft
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    FixedSizeFftBackend.cpp
+
+  ==============================================================================
+*/
+
+#include "FixedSizeFftBackend.h"
+#include "SpectralFrame.h"
+
+//==============================================================================
+FixedSizeFftBackend::FixedSizeFftBackend(fixedfft::Isa isa)
+    : requestedIsa(isa)
+{
+}
+
+FixedSizeFftBackend::~FixedSizeFftBackend()
+{
+}
+
+void FixedSizeFftBackend::prepare(int fftSize, int numChannels) {
+    // channels are transformed one by one, nothing depends on the count
+    channels = numChannels;
+    if (isPrepared() && fftSize == kernels.size) {
+        return;
+    }
+    jassert(fixedfft::isSupportedSize(fftSize));
+
+    kernels = fixedfft::getKernels(fftSize, requestedIsa);
+    if (! kernels.isValid()) {
+        return;
+    }
+    work.allocate((size_t) fixedfft::getWorkSize(fftSize));
+    splitBins.allocate((size_t) SpectralFrame::getChannelStride(fftSize));
+}
+
+void FixedSizeFftBackend::release() {
+    kernels = {};
+    channels = 0;
+    work.allocate(0);
+    splitBins.allocate(0);
+}
+
+//==============================================================================
+void FixedSizeFftBackend::forward(const float* input, std::complex<float>* output) {
+    jassert(isPrepared());
+
+    float* re = splitBins.get();
+    float* im = re + SpectralFrame::getPaddedNumBins(kernels.size);
+    kernels.forward(input, re, im, work.get());
+    for (int k=0; k<getNumBins(); k++) {
+        output[k] = { re[k], im[k] };
+    }
+    bytesCopied += sizeof(std::complex<float>) * getNumBins();
+}
+
+void FixedSizeFftBackend::inverse(const std::complex<float>* input, float* output) {
+    jassert(isPrepared());
+
+    float* re = splitBins.get();
+    float* im = re + SpectralFrame::getPaddedNumBins(kernels.size);
+    for (int k=0; k<getNumBins(); k++) {
+        re[k] = input[k].real();
+        im[k] = input[k].imag();
+    }
+    kernels.inverse(re, im, output, work.get());
+    bytesCopied += sizeof(std::complex<float>) * getNumBins();
+}
+
+void FixedSizeFftBackend::forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) {
+    jassert(isPrepared());
+
+    // the kernels write split bins, straight into the frame
+    for (int ch=0; ch<numChannels; ch++) {
+        kernels.forward(input + ch * kernels.size, real + ch * binStride, imag + ch * binStride, work.get());
+    }
+}
+
+void FixedSizeFftBackend::inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) {
+    jassert(isPrepared());
+
+    for (int ch=0; ch<numChannels; ch++) {
+        kernels.inverse(real + ch * binStride, imag + ch * binStride, output + ch * kernels.size, work.get());
+    }
+}
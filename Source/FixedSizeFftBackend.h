@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    FixedSizeFftBackend.h
+
+    FftBackend running on the compile-time kernels of FixedSizeFft.h, one
+    instantiation per size from 64 to 8192, on the widest simd instruction
+    set the cpu has. Needs no library and no planning: prepare() only looks
+    up the kernels and allocates scratch. Other sizes can't be prepared,
+    createFftBackend falls back to the radix backend for them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "FftBackend.h"
+#include "FixedSizeFft.h"
+#include "AlignedBuffer.h"
+
+//==============================================================================
+class FixedSizeFftBackend : public FftBackend
+{
+public:
+    // isa picks the kernels, e.g. to compare them. if the cpu can't run
+    // them the scalar ones are used.
+    explicit FixedSizeFftBackend(fixedfft::Isa isa = fixedfft::getBestIsa());
+    ~FixedSizeFftBackend() override;
+
+    const char* getName() const override { return "fixed"; }
+
+    void prepare(int fftSize, int numChannels) override;
+    void release() override;
+
+    bool isPrepared() const override { return kernels.isValid(); }
+    int getSize() const override { return kernels.size; }
+    int getNumChannels() const override { return channels; }
+
+    // the instruction set of the kernels in use
+    fixedfft::Isa getIsa() const { return kernels.isValid() ? kernels.isa : requestedIsa; }
+
+    void forward(const float* input, std::complex<float>* output) override;
+    void inverse(const std::complex<float>* input, float* output) override;
+    void forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) override;
+    void inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) override;
+
+private:
+    fixedfft::Isa requestedIsa;
+    fixedfft::Kernels kernels;
+    int channels = 0;
+
+    // scratch of the kernels
+    AlignedBuffer<float> work;
+    // split bins for the interleaved forward() and inverse()
+    AlignedBuffer<float> splitBins;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FixedSizeFftBackend)
+};
@@ -0,0 +1,220 @@
+/*
+  ==============================================================================
+
+    FixedSizeFftKernels.h
+
+    The transforms of FixedSizeFft.h, written once against the vector types
+    Wide and Quad. No include guard on purpose: FixedSizeFft.h includes this
+    inside one namespace per instruction set, don't include it anywhere else.
+
+  ==============================================================================
+*/
+
+// the widest vector whose lanes fit in a run of H butterflies
+template <int H>
+using PassOps = std::conditional_t<(H >= Wide::width), Wide,
+                                   std::conditional_t<(H >= Quad::width), Quad, simd::Scalar>>;
+
+// stages of half span H and 2H in one pass over M points, bit reversed
+// input. with a0..a3 the points j, j+H, j+2H and j+3H of a group of 4H:
+// the first stage pairs (a0, a1) and (a2, a3) with twiddle w1 = W(2H)^j,
+// the second (b0, b2) with w2 = W(4H)^j and (b1, b3) with W(4H)^(j+H),
+// which is -i * w2
+template <typename Ops, int M, int H>
+inline void radixFourPass(float* re, float* im) {
+    using V = typename Ops::V;
+    const float* w1Re = detail::PassTwiddles<H>::first.re.data();
+    const float* w1Im = detail::PassTwiddles<H>::first.im.data();
+    const float* w2Re = detail::PassTwiddles<H>::second.re.data();
+    const float* w2Im = detail::PassTwiddles<H>::second.im.data();
+
+    for (int start=0; start<M; start+=4*H) {
+        float* r0 = re + start;
+        float* i0 = im + start;
+        for (int j=0; j<H; j+=Ops::width) {
+            const V a0r = Ops::load(r0 + j),         a0i = Ops::load(i0 + j);
+            const V a1r = Ops::load(r0 + H + j),     a1i = Ops::load(i0 + H + j);
+            const V a2r = Ops::load(r0 + 2 * H + j), a2i = Ops::load(i0 + 2 * H + j);
+            const V a3r = Ops::load(r0 + 3 * H + j), a3i = Ops::load(i0 + 3 * H + j);
+
+            V b0r, b0i, b1r, b1i, b2r, b2i, b3r, b3i, vr, vi, xr, xi;
+            if constexpr (H == 1) {
+                // all twiddles are one
+                b0r = Ops::add(a0r, a1r); b0i = Ops::add(a0i, a1i);
+                b1r = Ops::sub(a0r, a1r); b1i = Ops::sub(a0i, a1i);
+                b2r = Ops::add(a2r, a3r); b2i = Ops::add(a2i, a3i);
+                b3r = Ops::sub(a2r, a3r); b3i = Ops::sub(a2i, a3i);
+                vr = b2r; vi = b2i;
+                xr = b3r; xi = b3i;
+            } else {
+                const V w1r = Ops::load(w1Re + j), w1i = Ops::load(w1Im + j);
+                const V w2r = Ops::load(w2Re + j), w2i = Ops::load(w2Im + j);
+
+                const V tr = Ops::sub(Ops::mul(a1r, w1r), Ops::mul(a1i, w1i));
+                const V ti = Ops::add(Ops::mul(a1r, w1i), Ops::mul(a1i, w1r));
+                b0r = Ops::add(a0r, tr); b0i = Ops::add(a0i, ti);
+                b1r = Ops::sub(a0r, tr); b1i = Ops::sub(a0i, ti);
+
+                const V ur = Ops::sub(Ops::mul(a3r, w1r), Ops::mul(a3i, w1i));
+                const V ui = Ops::add(Ops::mul(a3r, w1i), Ops::mul(a3i, w1r));
+                b2r = Ops::add(a2r, ur); b2i = Ops::add(a2i, ui);
+                b3r = Ops::sub(a2r, ur); b3i = Ops::sub(a2i, ui);
+
+                vr = Ops::sub(Ops::mul(b2r, w2r), Ops::mul(b2i, w2i));
+                vi = Ops::add(Ops::mul(b2r, w2i), Ops::mul(b2i, w2r));
+                xr = Ops::sub(Ops::mul(b3r, w2r), Ops::mul(b3i, w2i));
+                xi = Ops::add(Ops::mul(b3r, w2i), Ops::mul(b3i, w2r));
+            }
+
+            // -i * x = xi - i * xr
+            Ops::store(r0 + j,         Ops::add(b0r, vr)); Ops::store(i0 + j,         Ops::add(b0i, vi));
+            Ops::store(r0 + 2 * H + j, Ops::sub(b0r, vr)); Ops::store(i0 + 2 * H + j, Ops::sub(b0i, vi));
+            Ops::store(r0 + H + j,     Ops::add(b1r, xi)); Ops::store(i0 + H + j,     Ops::sub(b1i, xr));
+            Ops::store(r0 + 3 * H + j, Ops::sub(b1r, xi)); Ops::store(i0 + 3 * H + j, Ops::add(b1i, xr));
+        }
+    }
+}
+
+// the last stage when the number of stages is odd, H = M / 2
+template <typename Ops, int M, int H>
+inline void radixTwoPass(float* re, float* im) {
+    using V = typename Ops::V;
+    const float* wRe = detail::PassTwiddles<H>::first.re.data();
+    const float* wIm = detail::PassTwiddles<H>::first.im.data();
+
+    for (int start=0; start<M; start+=2*H) {
+        float* aRe = re + start;
+        float* aIm = im + start;
+        for (int j=0; j<H; j+=Ops::width) {
+            const V wr = Ops::load(wRe + j), wi = Ops::load(wIm + j);
+            const V br = Ops::load(aRe + H + j), bi = Ops::load(aIm + H + j);
+            const V ar = Ops::load(aRe + j), ai = Ops::load(aIm + j);
+            const V tr = Ops::sub(Ops::mul(br, wr), Ops::mul(bi, wi));
+            const V ti = Ops::add(Ops::mul(br, wi), Ops::mul(bi, wr));
+            Ops::store(aRe + j, Ops::add(ar, tr));     Ops::store(aIm + j, Ops::add(ai, ti));
+            Ops::store(aRe + H + j, Ops::sub(ar, tr)); Ops::store(aIm + H + j, Ops::sub(ai, ti));
+        }
+    }
+}
+
+// every pass of the complex transform of M points from half span H on,
+// unrolled by the recursion into straight calls with constant bounds
+template <int M, int H>
+inline void complexPasses(float* re, float* im) {
+    if constexpr (4 * H <= M) {
+        radixFourPass<PassOps<H>, M, H>(re, im);
+        complexPasses<M, 4 * H>(re, im);
+    } else if constexpr (2 * H <= M) {
+        radixTwoPass<PassOps<H>, M, H>(re, im);
+    }
+}
+
+//==============================================================================
+// work holds the complex transform of N/2 points, real then imaginary part
+template <int N>
+void forward(const float* input, float* real, float* imag, float* work) {
+    constexpr int half = N / 2;
+    using Ops = PassOps<half / 2>;
+    using V = typename Ops::V;
+    const auto& order = detail::BitReverse<half>::value;
+    const float* twiddlesRe = detail::SplitTwiddles<N>::value.re.data();
+    const float* twiddlesIm = detail::SplitTwiddles<N>::value.im.data();
+    float* zRe = work;
+    float* zIm = work + half;
+
+    // even samples in the real part, odd ones in the imaginary part
+    for (int k=0; k<half; k++) {
+        zRe[order[(size_t) k]] = input[2 * k];
+        zIm[order[(size_t) k]] = input[2 * k + 1];
+    }
+
+    complexPasses<half, 1>(zRe, zIm);
+
+    // split step, as RadixFftBackend::forwardStrided. the conjugate mirror
+    // Z[half-k] of a vector of bins is a reversed vector further down.
+    real[0] = zRe[0] + zIm[0];
+    imag[0] = 0.0f;
+    real[half] = zRe[0] - zIm[0];
+    imag[half] = 0.0f;
+    const V halfGain = Ops::set(0.5f);
+    int k = 1;
+    for (; k + Ops::width <= half; k+=Ops::width) {
+        const V zr = Ops::load(zRe + k), zi = Ops::load(zIm + k);
+        const V cr = Ops::reverse(Ops::load(zRe + half - k - Ops::width + 1));
+        const V ci = Ops::reverse(Ops::load(zIm + half - k - Ops::width + 1));
+        const V eRe = Ops::mul(halfGain, Ops::add(zr, cr));
+        const V eIm = Ops::mul(halfGain, Ops::sub(zi, ci));
+        const V oRe = Ops::mul(halfGain, Ops::sub(zr, cr));
+        const V oIm = Ops::mul(halfGain, Ops::add(zi, ci));
+        const V wr = Ops::load(twiddlesRe + k), wi = Ops::load(twiddlesIm + k);
+        Ops::store(real + k, Ops::add(eRe, Ops::add(Ops::mul(wr, oIm), Ops::mul(wi, oRe))));
+        Ops::store(imag + k, Ops::sub(eIm, Ops::sub(Ops::mul(wr, oRe), Ops::mul(wi, oIm))));
+    }
+    for (; k<half; k++) {
+        const float cr = zRe[half - k];
+        const float ci = -zIm[half - k];
+        const float eRe = 0.5f * (zRe[k] + cr);
+        const float eIm = 0.5f * (zIm[k] + ci);
+        const float oRe = 0.5f * (zRe[k] - cr);
+        const float oIm = 0.5f * (zIm[k] - ci);
+        real[k] = eRe + (twiddlesRe[k] * oIm + twiddlesIm[k] * oRe);
+        imag[k] = eIm - (twiddlesRe[k] * oRe - twiddlesIm[k] * oIm);
+    }
+}
+
+// work holds the merged spectrum in natural order after the complex one
+template <int N>
+void inverse(const float* real, const float* imag, float* output, float* work) {
+    constexpr int half = N / 2;
+    using Ops = PassOps<half / 2>;
+    using V = typename Ops::V;
+    const auto& order = detail::BitReverse<half>::value;
+    const float* twiddlesRe = detail::SplitTwiddles<N>::value.re.data();
+    const float* twiddlesIm = detail::SplitTwiddles<N>::value.im.data();
+    float* zRe = work;
+    float* zIm = work + half;
+    float* mergedRe = work + 2 * half;
+    float* mergedIm = work + 3 * half;
+
+    // merge step, as RadixFftBackend::inverseStrided: the inverse runs as
+    // conj(fft(conj(Z))), so the imaginary part is stored negated
+    int k = 0;
+    for (; k + Ops::width <= half; k+=Ops::width) {
+        const V xr = Ops::load(real + k), xi = Ops::load(imag + k);
+        const V cr = Ops::reverse(Ops::load(real + half - k - Ops::width + 1));
+        const V ci = Ops::reverse(Ops::load(imag + half - k - Ops::width + 1));
+        const V eRe = Ops::add(xr, cr);
+        const V eIm = Ops::sub(xi, ci);
+        const V dRe = Ops::sub(xr, cr);
+        const V dIm = Ops::add(xi, ci);
+        const V wr = Ops::load(twiddlesRe + k), wi = Ops::load(twiddlesIm + k);
+        // o = d * conj(w)
+        const V oRe = Ops::add(Ops::mul(dRe, wr), Ops::mul(dIm, wi));
+        const V oIm = Ops::sub(Ops::mul(dIm, wr), Ops::mul(dRe, wi));
+        Ops::store(mergedRe + k, Ops::sub(eRe, oIm));
+        Ops::store(mergedIm + k, Ops::sub(Ops::set(0.0f), Ops::add(eIm, oRe)));
+    }
+    for (; k<half; k++) {
+        const float cr = real[half - k];
+        const float ci = -imag[half - k];
+        const float eRe = real[k] + cr;
+        const float eIm = imag[k] + ci;
+        const float dRe = real[k] - cr;
+        const float dIm = imag[k] - ci;
+        const float oRe = dRe * twiddlesRe[k] + dIm * twiddlesIm[k];
+        const float oIm = dIm * twiddlesRe[k] - dRe * twiddlesIm[k];
+        mergedRe[k] = eRe - oIm;
+        mergedIm[k] = -(eIm + oRe);
+    }
+    for (k=0; k<half; k++) {
+        zRe[order[(size_t) k]] = mergedRe[k];
+        zIm[order[(size_t) k]] = mergedIm[k];
+    }
+
+    complexPasses<half, 1>(zRe, zIm);
+
+    for (k=0; k<half; k++) {
+        output[2 * k] = zRe[k];
+        output[2 * k + 1] = -zIm[k];
+    }
+}
@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    JuceFftBackend.cpp
+
+  ==============================================================================
+*/
+
+#include "JuceFftBackend.h"
+#include "FftResourceRegistry.h"
+
+//==============================================================================
+JuceFftBackend::JuceFftBackend()
+{
+}
+
+JuceFftBackend::~JuceFftBackend()
+{
+}
+
+void JuceFftBackend::prepare(int fftSize, int numChannels) {
+    // channels are transformed one by one, nothing depends on the count
+    channels = numChannels;
+    if (isPrepared() && fftSize == size) {
+        return;
+    }
+    jassert(juce::isPowerOfTwo(fftSize));
+
+    size = fftSize;
+    FftResourceKey key;
+    key.kind = FftResourceKind::juceFft;
+    key.fftSize = size;
+    key.precision = (int) sizeof(float);
+    key.backend = FftBackendType::juce;
+    fft = FftResourceRegistry::getInstance().getOrCreate<SharedFft>(key, [this] {
+        return std::make_shared<SharedFft>(juce::roundToInt(std::log2(size)));
+    });
+    workBuffer.allocate(2 * size, true);
+    pairBuffer.allocate(2 * size, true);
+}
+
+void JuceFftBackend::release() {
+    fft.reset();
+    workBuffer.free();
+    pairBuffer.free();
+    size = 0;
+    channels = 0;
+}
+
+void JuceFftBackend::forward(const float* input, std::complex<float>* output) {
+    jassert(isPrepared());
+
+    juce::FloatVectorOperations::copy(workBuffer.get(), input, size);
+    fft->transform.performRealOnlyForwardTransform(workBuffer.get(), true);
+
+    // the first size/2+1 interleaved complex values are the unique bins
+    std::memcpy((void*) output, workBuffer.get(), sizeof(std::complex<float>) * getNumBins());
+    bytesCopied += sizeof(float) * size + sizeof(std::complex<float>) * getNumBins();
+}
+
+void JuceFftBackend::inverse(const std::complex<float>* input, float* output) {
+    jassert(isPrepared());
+
+    // juce rebuilds the negative frequencies from the first size/2+1 bins
+    std::memcpy(workBuffer.get(), input, sizeof(std::complex<float>) * getNumBins());
+    fft->transform.performRealOnlyInverseTransform(workBuffer.get());
+
+    // juce scales the inverse by 1/size, undo it to keep the fftw convention
+    juce::FloatVectorOperations::multiply(output, workBuffer.get(), (float) size, size);
+    bytesCopied += sizeof(std::complex<float>) * getNumBins() + sizeof(float) * size;
+}
+
+void JuceFftBackend::forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) {
+    jassert(isPrepared());
+
+    for (int ch=0; ch<numChannels; ch++) {
+        juce::FloatVectorOperations::copy(workBuffer.get(), input + ch * size, size);
+        fft->transform.performRealOnlyForwardTransform(workBuffer.get(), true);
+
+        // juce only works interleaved, split the unique bins
+        float* re = real + ch * binStride;
+        float* im = imag + ch * binStride;
+        for (int k=0; k<getNumBins(); k++) {
+            re[k] = workBuffer[2 * k];
+            im[k] = workBuffer[2 * k + 1];
+        }
+        bytesCopied += sizeof(float) * size + sizeof(std::complex<float>) * getNumBins();
+    }
+}
+
+void JuceFftBackend::inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) {
+    jassert(isPrepared());
+
+    for (int ch=0; ch<numChannels; ch++) {
+        const float* re = real + ch * binStride;
+        const float* im = imag + ch * binStride;
+        for (int k=0; k<getNumBins(); k++) {
+            workBuffer[2 * k] = re[k];
+            workBuffer[2 * k + 1] = im[k];
+        }
+        fft->transform.performRealOnlyInverseTransform(workBuffer.get());
+        juce::FloatVectorOperations::multiply(output + ch * size, workBuffer.get(), (float) size, size);
+        bytesCopied += sizeof(std::complex<float>) * getNumBins() + sizeof(float) * size;
+    }
+}
+
+void JuceFftBackend::forwardPair(const float* input, float* real, float* imag, int binStride) {
+    jassert(isPrepared());
+
+    // interleave the channels as the real and imaginary parts of one signal
+    const float* second = input + size;
+    for (int i=0; i<size; i++) {
+        workBuffer[2 * i] = input[i];
+        workBuffer[2 * i + 1] = second[i];
+    }
+    fft->transform.perform(reinterpret_cast<const juce::dsp::Complex<float>*>(workBuffer.get()),
+                 reinterpret_cast<juce::dsp::Complex<float>*>(pairBuffer.get()), false);
+
+    separatePair(pairBuffer.get(), pairBuffer.get() + 1, 2, size, real, imag, binStride);
+    bytesCopied += 2 * sizeof(float) * size;
+}
+
+void JuceFftBackend::inversePair(float* real, float* imag, float* output, int binStride) {
+    jassert(isPrepared());
+
+    combinePair(real, imag, binStride, size, workBuffer.get(), workBuffer.get() + 1, 2);
+    fft->transform.perform(reinterpret_cast<const juce::dsp::Complex<float>*>(workBuffer.get()),
+                 reinterpret_cast<juce::dsp::Complex<float>*>(pairBuffer.get()), true);
+
+    // the inverse is scaled by 1/size here too
+    float* second = output + size;
+    for (int i=0; i<size; i++) {
+        output[i] = pairBuffer[2 * i] * (float) size;
+        second[i] = pairBuffer[2 * i + 1] * (float) size;
+    }
+    bytesCopied += 2 * sizeof(float) * size;
+}
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    JuceFftBackend.h
+
+    FftBackend running on juce::dsp::FFT, which picks vDSP, IPP or its own
+    fallback engine depending on the platform. Power of two sizes only.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "FftBackend.h"
+
+//==============================================================================
+class JuceFftBackend : public FftBackend
+{
+public:
+    JuceFftBackend();
+    ~JuceFftBackend() override;
+
+    const char* getName() const override { return "juce"; }
+
+    void prepare(int fftSize, int numChannels) override;
+    void release() override;
+
+    bool isPrepared() const override { return fft != nullptr; }
+    int getSize() const override { return size; }
+    int getNumChannels() const override { return channels; }
+
+    void forward(const float* input, std::complex<float>* output) override;
+    void inverse(const std::complex<float>* input, float* output) override;
+    void forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) override;
+    void inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) override;
+    // one complex perform() for both channels
+    void forwardPair(const float* input, float* real, float* imag, int binStride) override;
+    void inversePair(float* real, float* imag, float* output, int binStride) override;
+
+private:
+    int size = 0;
+    int channels = 0;
+
+    // one juce::dsp::FFT per order, shared by every juce backend of that
+    // size through FftResourceRegistry. its transforms are const and keep
+    // no state between calls (the IPP engine would, it isn't enabled here).
+    struct SharedFft
+    {
+        explicit SharedFft(int order) : transform(order) {}
+        // juce doesn't report its tables, count the twiddles of its
+        // fallback engine
+        size_t getNumBytes() const { return sizeof(std::complex<float>) * (size_t) transform.getSize(); }
+
+        juce::dsp::FFT transform;
+    };
+    std::shared_ptr<const SharedFft> fft;
+    // juce works in place on 2 * size floats
+    juce::HeapBlock<float> workBuffer;
+    // output of the out-of-place complex transforms, 2 * size floats
+    juce::HeapBlock<float> pairBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (JuceFftBackend)
+};
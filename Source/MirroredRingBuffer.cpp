@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    MirroredRingBuffer.cpp
+
+  ==============================================================================
+*/
+
+#include "MirroredRingBuffer.h"
+
+#if JUCE_LINUX
+ #define MIRRORED_RING_USE_MEMFD 1
+ #include <sys/mman.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#else
+ #define MIRRORED_RING_USE_MEMFD 0
+#endif
+
+//==============================================================================
+MirroredRingBuffer::MirroredRingBuffer()
+{
+}
+
+MirroredRingBuffer::~MirroredRingBuffer()
+{
+    release();
+}
+
+void MirroredRingBuffer::setSize(int numChannels, int minCapacity) {
+    release();
+    jassert(numChannels > 0 && minCapacity > 0);
+
+    if (createMappings(numChannels, minCapacity)) {
+        mapped = true;
+        return;
+    }
+
+    capacity = minCapacity;
+    fallback.allocate((size_t) (2 * capacity * numChannels));
+    for (int ch=0; ch<numChannels; ch++) {
+        channels.push_back(fallback.get() + 2 * capacity * ch);
+    }
+}
+
+void MirroredRingBuffer::release() {
+   #if MIRRORED_RING_USE_MEMFD
+    if (mapped) {
+        for (auto* data : channels) {
+            munmap(data, 2 * sizeof(float) * (size_t) capacity);
+        }
+    }
+   #endif
+    channels.clear();
+    capacity = 0;
+    mapped = false;
+}
+
+void MirroredRingBuffer::clear() {
+    // clearing one half clears both when mapped
+    for (auto* data : channels) {
+        std::fill(data, data + (mapped ? capacity : 2 * capacity), 0.0f);
+    }
+}
+
+bool MirroredRingBuffer::createMappings(int numChannels, int minCapacity) {
+   #if MIRRORED_RING_USE_MEMFD
+    const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t bytes = (sizeof(float) * (size_t) minCapacity + pageSize - 1) / pageSize * pageSize;
+    capacity = (int) (bytes / sizeof(float));
+
+    for (int ch=0; ch<numChannels; ch++) {
+        // memfd pages are zero filled, so the ring starts cleared
+        const int fd = (int) syscall(SYS_memfd_create, "stft ring", 0u);
+        if (fd < 0) {
+            break;
+        }
+        void* data = nullptr;
+        if (ftruncate(fd, (off_t) bytes) == 0) {
+            // reserve both halves, then map the same pages over each of them
+            void* reserved = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (reserved != MAP_FAILED) {
+                auto* first = static_cast<char*>(reserved);
+                if (mmap(first, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED
+                    && mmap(first + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                    data = reserved;
+                } else {
+                    munmap(reserved, 2 * bytes);
+                }
+            }
+        }
+        // the mappings keep the pages alive
+        close(fd);
+        if (data == nullptr) {
+            break;
+        }
+        channels.push_back(static_cast<float*>(data));
+    }
+
+    if ((int) channels.size() == numChannels) {
+        return true;
+    }
+    for (auto* data : channels) {
+        munmap(data, 2 * bytes);
+    }
+    channels.clear();
+    capacity = 0;
+   #else
+    juce::ignoreUnused(numChannels, minCapacity);
+   #endif
+    return false;
+}
+
+void MirroredRingBuffer::mirror(int channel, int position, int numSamples) {
+    float* data = channels[(size_t) channel];
+    // the part in the first half goes to the second, the part that ran past
+    // the end goes back to the start
+    const int end = position + numSamples;
+    const int numInFirst = juce::jmin(end, capacity) - position;
+    if (numInFirst > 0) {
+        std::memcpy(data + position + capacity, data + position, sizeof(float) * (size_t) numInFirst);
+    }
+    if (end > capacity) {
+        std::memcpy(data, data + capacity, sizeof(float) * (size_t) (end - capacity));
+    }
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    MirroredRingBuffer.h
+
+    Circular buffers, one per channel, where any window of up to capacity
+    samples is one contiguous run of memory, wherever it starts. On Linux the
+    same memfd pages are mapped twice back to back, so a write shows up in
+    both halves for free and the capacity is rounded up to whole pages.
+    Elsewhere, or if the mapping fails, every channel gets two plain copies
+    and writes are mirrored into the second one (copy on wrap).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "AlignedBuffer.h"
+
+//==============================================================================
+class MirroredRingBuffer
+{
+public:
+    MirroredRingBuffer();
+    ~MirroredRingBuffer();
+
+    // allocates numChannels cleared rings of at least minCapacity samples.
+    // not real-time safe.
+    void setSize(int numChannels, int minCapacity);
+    void release();
+    void clear();
+
+    int getNumChannels() const { return (int) channels.size(); }
+    int getCapacity() const { return capacity; }
+    // false when running on the copy on wrap fallback
+    bool isMapped() const { return mapped; }
+
+    // capacity contiguous samples starting at position, 0 <= position < capacity
+    const float* getReadPointer(int channel, int position) const { return channels[(size_t) channel] + position; }
+
+    // same for writing. after writing, call finishedWrite for the samples
+    // touched so the fallback can mirror them.
+    float* getWritePointer(int channel, int position) { return channels[(size_t) channel] + position; }
+    void finishedWrite(int channel, int position, int numSamples) {
+        if (! mapped) {
+            mirror(channel, position, numSamples);
+        }
+    }
+
+    // copies numSamples <= capacity samples in starting at position, a
+    // single memcpy when mapped
+    void write(int channel, int position, const float* source, int numSamples) {
+        std::memcpy(getWritePointer(channel, position), source, sizeof(float) * (size_t) numSamples);
+        finishedWrite(channel, position, numSamples);
+    }
+
+private:
+    bool createMappings(int numChannels, int minCapacity);
+    // copies what was written in [position, position + numSamples) to the
+    // other half of the fallback storage
+    void mirror(int channel, int position, int numSamples);
+
+    int capacity = 0;
+    bool mapped = false;
+
+    // start of every channel's doubled range
+    std::vector<float*> channels;
+    // fallback storage, 2 * capacity samples per channel
+    AlignedBuffer<float> fallback;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MirroredRingBuffer)
+};
@@ -8,14 +8,21 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "FftResourceRegistry.h"
 
 //==============================================================================
 FftPassthroughAudioProcessorEditor::FftPassthroughAudioProcessorEditor (FftPassthroughAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), analyzer (p.getSpectrumFifo())
 {
+    addAndMakeVisible (analyzer);
+    addAndMakeVisible (impulseButton);
+    impulseButton.setButtonText ("Load IR...");
+    impulseButton.onClick = [this] { chooseImpulseResponse(); };
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (600, 600);
+    startTimerHz (10);
 }
 
 FftPassthroughAudioProcessorEditor::~FftPassthroughAudioProcessorEditor()
@@ -28,13 +35,91 @@ void FftPassthroughAudioProcessorEditor::paint (juce::Graphics& g)
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 
+    auto area = telemetryArea.reduced (12);
+    auto nextLine = [&area] { return area.removeFromTop (20); };
+
     g.setColour (juce::Colours::white);
     g.setFont (15.0f);
-    g.drawFittedText ("Hello YOU!", getLocalBounds(), juce::Justification::centred, 1);
+    g.drawText ("DSP load " + juce::String (telemetry.load * 100.0f, 1) + " %,  worst callback "
+                + juce::String (telemetry.worstLoad * 100.0f, 1) + " % ("
+                + juce::String (telemetry.worstCallbackSeconds * 1000.0, 2) + " ms)",
+                nextLine(), juce::Justification::centredLeft);
+
+    g.setFont (13.0f);
+    g.drawText (juce::String (telemetry.numCallbacks) + " callbacks,  "
+                + juce::String (telemetry.numRiskyCallbacks) + " above "
+                + juce::String (juce::roundToInt (DspTelemetry::riskLoad * 100.0)) + " %,  "
+                + juce::String (telemetry.numOverruns) + " over deadline",
+                nextLine(), juce::Justification::centredLeft);
+    g.drawText ("Worker underruns " + juce::String (audioProcessor.getNumWorkerUnderruns())
+                + ",  " + juce::String (audioProcessor.getBytesMovedPerHop()) + " bytes moved per hop",
+                nextLine(), juce::Justification::centredLeft);
+    // plans, twiddles and windows shared with the other instances in this process
+    const auto shared = FftResourceRegistry::getInstance().getStats();
+    g.drawText ("Shared tables " + juce::String (shared.numEntries) + " ("
+                + juce::String (shared.numBytes / 1024) + " kB, " + juce::String (shared.numBytesShared / 1024) + " kB saved),  "
+                + juce::String (shared.numHits) + " hits, " + juce::String (shared.numMisses) + " misses",
+                nextLine(), juce::Justification::centredLeft);
+    area.removeFromTop (6);
+
+    // mean time per frame stage since the last poll
+    for (int i=0; i<numDspStages; i++) {
+        const auto runs = telemetry.stageRuns[i] - previousTelemetry.stageRuns[i];
+        const double seconds = telemetry.stageSeconds[i] - previousTelemetry.stageSeconds[i];
+        const auto text = runs > 0 ? juce::String (seconds / runs * 1.0e6, 1) + " us" : juce::String ("-");
+        auto line = nextLine();
+        g.drawText (getDspStageName ((DspStage) i), line.removeFromLeft (120), juce::Justification::centredLeft);
+        g.drawText (text, line, juce::Justification::centredLeft);
+    }
+    area.removeFromTop (6);
+
+    // deadline use histogram, one bar per 10 %, the last one for overruns
+    auto labels = area.removeFromBottom (16);
+    juce::uint32 highest = 1;
+    for (auto count : telemetry.loadHistogram) {
+        highest = juce::jmax (highest, count);
+    }
+    const float barWidth = (float) area.getWidth() / DspTelemetry::numLoadBuckets;
+    for (int i=0; i<DspTelemetry::numLoadBuckets; i++) {
+        // log scale, the rare slow callbacks are the interesting ones
+        const float height = (float) area.getHeight() * std::log1p ((float) telemetry.loadHistogram[i]) / std::log1p ((float) highest);
+        g.setColour (i >= juce::roundToInt (DspTelemetry::riskLoad * 10.0) ? juce::Colours::orangered : juce::Colours::lightgreen);
+        g.fillRect (juce::Rectangle<float> (area.getX() + i * barWidth + 1.0f, (float) area.getBottom() - height, barWidth - 2.0f, height));
+    }
+    g.setColour (juce::Colours::white);
+    g.setFont (11.0f);
+    g.drawText ("0 %", labels, juce::Justification::centredLeft);
+    g.drawText ("deadline use", labels, juce::Justification::centred);
+    g.drawText (">100 %", labels, juce::Justification::centredRight);
+}
+
+void FftPassthroughAudioProcessorEditor::timerCallback()
+{
+    previousTelemetry = telemetry;
+    telemetry = audioProcessor.getTelemetry().getSnapshot();
+    repaint (telemetryArea);
+
+    const auto impulseName = audioProcessor.getImpulseResponseName();
+    impulseButton.setButtonText (impulseName.isEmpty() ? juce::String ("Load IR...") : impulseName);
+}
+
+void FftPassthroughAudioProcessorEditor::chooseImpulseResponse()
+{
+    impulseChooser = std::make_unique<juce::FileChooser> ("Impulse response for the convolution", juce::File(),
+                                                          "*.wav;*.aif;*.aiff;*.flac;*.ogg");
+    impulseChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                                 [this] (const juce::FileChooser& chooser) {
+                                     const auto file = chooser.getResult();
+                                     if (file.existsAsFile()) {
+                                         audioProcessor.loadImpulseResponse (file);
+                                     }
+                                 });
 }
 
 void FftPassthroughAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    auto area = getLocalBounds();
+    analyzer.setBounds (area.removeFromBottom (area.getHeight() / 2));
+    telemetryArea = area;
+    impulseButton.setBounds (area.reduced (12).removeFromTop (24).removeFromRight (160));
 }
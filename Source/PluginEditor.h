@@ -10,11 +10,13 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SpectrumAnalyzerComponent.h"
 
 //==============================================================================
 /**
 */
-class FftPassthroughAudioProcessorEditor  : public juce::AudioProcessorEditor
+class FftPassthroughAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                            private juce::Timer
 {
 public:
     FftPassthroughAudioProcessorEditor (FftPassthroughAudioProcessor&);
@@ -25,9 +27,22 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+    void chooseImpulseResponse();
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     FftPassthroughAudioProcessor& audioProcessor;
 
+    // telemetry at the last two polls, the stage means are taken between them
+    DspTelemetry::Snapshot telemetry, previousTelemetry;
+    // the part above the analyzer, the timer repaints only this
+    juce::Rectangle<int> telemetryArea;
+
+    SpectrumAnalyzerComponent analyzer;
+    // picks the convolution's impulse response, shows the one in use
+    juce::TextButton impulseButton;
+    std::unique_ptr<juce::FileChooser> impulseChooser;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FftPassthroughAudioProcessorEditor)
 };
@@ -8,7 +8,38 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include <fftw3.h>
+#include "RealtimeAllocationGuard.h"
+
+// tools building the processor outside the plugin project don't get the
+// plugin defines
+#ifndef JucePlugin_Name
+ #define JucePlugin_Name "FftPassthrough"
+#endif
+
+// selectable fft and hop sizes, in samples at 48 kHz when auto scaling is on
+static const int fftSizeChoices[] = { 256, 512, 1024, 2048, 4096, 8192 };
+static const int hopSizeChoices[] = { 32, 64, 128, 256, 512, 1024 };
+
+//==============================================================================
+class FftPassthroughAudioProcessor::EngineBuilder : public juce::Thread
+{
+public:
+    explicit EngineBuilder(FftPassthroughAudioProcessor& p)
+        : juce::Thread("stft engine builder"), owner(p)
+    {
+    }
+
+    void run() override {
+        while (! threadShouldExit()) {
+            owner.loadPendingImpulseResponse();
+            owner.updateEngine();
+            wait(20);
+        }
+    }
+
+private:
+    FftPassthroughAudioProcessor& owner;
+};
 
 //==============================================================================
 FftPassthroughAudioProcessor::FftPassthroughAudioProcessor()
@@ -22,11 +53,58 @@ FftPassthroughAudioProcessor::FftPassthroughAudioProcessor()
                      #endif
                        )
 #endif
+     , parameters (*this, nullptr, "PARAMETERS", createParameterLayout())
 {
+    engineBuilder = std::make_unique<EngineBuilder>(*this);
 }
 
 FftPassthroughAudioProcessor::~FftPassthroughAudioProcessor()
 {
+    engineBuilder->stopThread(2000);
+    clearPendingEngines();
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout FftPassthroughAudioProcessor::createParameterLayout()
+{
+    juce::StringArray fftSizeNames, hopSizeNames;
+    int defaultFftIndex = 0, defaultHopIndex = 0;
+    for (int i=0; i<juce::numElementsInArray(fftSizeChoices); i++) {
+        fftSizeNames.add(juce::String(fftSizeChoices[i]));
+        if (fftSizeChoices[i] == FFT_SIZE) {
+            defaultFftIndex = i;
+        }
+    }
+    for (int i=0; i<juce::numElementsInArray(hopSizeChoices); i++) {
+        hopSizeNames.add(juce::String(hopSizeChoices[i]));
+        if (hopSizeChoices[i] == HOP_SIZE) {
+            defaultHopIndex = i;
+        }
+    }
+
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "fftSize", 1 }, "FFT Size", fftSizeNames, defaultFftIndex));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "hopSize", 1 }, "Hop Size", hopSizeNames, defaultHopIndex));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "autoScale", 1 }, "Scale With Sample Rate", false));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "window", 1 }, "Window",
+                                                            juce::StringArray { getWindowName(WindowType::hann),
+                                                                                getWindowName(WindowType::sqrtHann),
+                                                                                getWindowName(WindowType::blackmanHarris) },
+                                                            (int) WindowType::sqrtHann));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "scheduling", 1 }, "Frame Scheduling",
+                                                            juce::StringArray { getFrameSchedulingName(FrameScheduling::immediate),
+                                                                                getFrameSchedulingName(FrameScheduling::spread),
+                                                                                getFrameSchedulingName(FrameScheduling::worker) },
+                                                            (int) FrameScheduling::immediate));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "processor", 1 }, "Spectral Processor",
+                                                            juce::StringArray { getSpectralProcessorName(SpectralProcessorType::passthrough),
+                                                                                getSpectralProcessorName(SpectralProcessorType::robotize),
+                                                                                getSpectralProcessorName(SpectralProcessorType::spectralGate),
+                                                                                getSpectralProcessorName(SpectralProcessorType::convolution) },
+                                                            (int) SpectralProcessorType::passthrough));
+    // stereo only: both channels through one complex transform per hop
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "stereoTransform", 1 }, "Stereo Transform",
+                                                            juce::StringArray { "Per Channel", "Packed Pair" }, 0));
+    return layout;
 }
 
 //==============================================================================
@@ -64,7 +142,8 @@ bool FftPassthroughAudioProcessor::isMidiEffect() const
 
 double FftPassthroughAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const double sampleRate = getSampleRate();
+    return sampleRate > 0.0 ? activeTail.load() / sampleRate : 0.0;
 }
 
 int FftPassthroughAudioProcessor::getNumPrograms()
@@ -94,29 +173,66 @@ void FftPassthroughAudioProcessor::changeProgramName (int index, const juce::Str
 //==============================================================================
 void FftPassthroughAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    currentBufferSize = (float) samplesPerBlock;
-    currentSampleRate = sampleRate;
-    
-    inWritePointer = FFT_SIZE;
-    inReadPointer = 0;
-    hopCounter = 0;
-    inBuffer = new float[CBUFFER_SIZE];
-    for (int i=0; i<CBUFFER_SIZE; i++) {
-        inBuffer[i] = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(engineLock);
+        currentBufferSize.store(samplesPerBlock);
+        currentSampleRate.store(sampleRate);
+        
+        // every channel of the bus gets its own stft state
+        numStftChannels = juce::jmax(1, getTotalNumInputChannels(), getTotalNumOutputChannels());
+        
+        // the convolution needs its impulse response at the new rate
+        {
+            std::lock_guard<std::mutex> irLock(impulseLock);
+            if (sourceImpulse != nullptr && (impulseResponse == nullptr || impulseResponse->sampleRate != sampleRate)) {
+                impulseResponse = resampleImpulseResponse(*sourceImpulse, sampleRate);
+            }
+        }
+        
+        // build the first engine right here, later changes are built by the
+        // background thread
+        clearPendingEngines();
+        const auto config = getRequestedConfig();
+        if (activeEngine == nullptr || activeEngine->getConfig() != config) {
+            // without an engine processBlock passes the input through
+            activeEngine = createStftEngine(config);
+        } else {
+            activeEngine->reset();
+        }
+        // about 60 analyzer frames per second
+        spectrumFifo.setFrameInterval(juce::roundToInt(sampleRate / 60.0));
+        spectrumFifo.setFormat(sampleRate, config.fftSize);
+        if (activeEngine != nullptr) {
+            activeEngine->setSpectrumFifo(&spectrumFifo);
+        }
+        latestConfig = config;
+        isPrepared = true;
+        
+        activeLatency.store(config.getLatencySamples());
+        activeTail.store(config.getTailSamples());
+        setLatencySamples(config.getLatencySamples());
     }
     
-    outWritePointer = HOP_SIZE;
-    outReadPointer = 0;
-    outBuffer = new float[CBUFFER_SIZE];
-    for (int i=0; i<CBUFFER_SIZE; i++) {
-        inBuffer[i] = 0.0;
+    fadeChannels.resize((size_t) numStftChannels);
+    arena.allocate((size_t) numStftChannels * AlignedArena::getBlockSize<float>((size_t) samplesPerBlock));
+    for (auto& channel : fadeChannels) {
+        channel = arena.take<float>((size_t) samplesPerBlock);
     }
+    fadeBuffer.setDataToReferTo(fadeChannels.data(), numStftChannels, samplesPerBlock);
+    telemetry.prepare(sampleRate);
+    engineBuilder->startThread();
 }
 
 void FftPassthroughAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    engineBuilder->stopThread(2000);
+    
+    std::lock_guard<std::mutex> lock(engineLock);
+    clearPendingEngines();
+    activeEngine.reset();
+    isPrepared = false;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -148,33 +264,76 @@ bool FftPassthroughAudioProcessor::isBusesLayoutSupported (const BusesLayout& la
 void FftPassthroughAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
-    //auto totalNumInputChannels  = getTotalNumInputChannels();
-    //auto totalNumOutputChannels = getTotalNumOutputChannels();
-
-    auto* channelData = buffer.getWritePointer (0);
-    for (int i=0; i<currentBufferSize; i++) {
-        
-        // store juce input signal into input buffer
-        inBuffer[inWritePointer] = channelData[i];
-        inWritePointer++;
-        if (inWritePointer >= CBUFFER_SIZE) {
-            inWritePointer = 0;
+    // debug builds abort on any operator new or delete from here on
+    ScopedRealtimeAllocationGuard noAllocations;
+    DspTelemetry::ScopedCallback callbackTimer(telemetry, buffer.getNumSamples());
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+
+    // clear outputs that have no input, they are then processed as silence
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+
+    // take over a newly built engine, unless the previous swap is still
+    // being faded or hasn't been collected by the builder yet
+    if (fadingEngine == nullptr && retiredEngine.load() == nullptr) {
+        if (auto* next = pendingEngine.exchange(nullptr)) {
+            fadingEngine = std::move(activeEngine);
+            activeEngine.reset(next);
+            // only the engine taking over feeds the analyzer
+            if (fadingEngine != nullptr) {
+                fadingEngine->setSpectrumFifo(nullptr);
+            }
+            activeEngine->setSpectrumFifo(&spectrumFifo);
+            spectrumFifo.setFormat(getSampleRate(), next->getConfig().fftSize);
+            fadePosition = 0;
+            activeLatency.store(next->getConfig().getLatencySamples());
+            activeTail.store(next->getConfig().getTailSamples());
         }
-        hopCounter++;
-        
-        // do spectral processing
-        if (hopCounter >= HOP_SIZE) {
-            hopCounter = 0;
-            processFft();
+    }
+    
+    if (activeEngine == nullptr) {
+        return;
+    }
+    
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+    
+    // a block larger than announced can't be faded, switch straight over
+    if (fadingEngine != nullptr && numSamples > fadeBuffer.getNumSamples()) {
+        retiredEngine.store(fadingEngine.release());
+    }
+    
+    // the old engine keeps running on a copy of the input while it fades out
+    const int numFadeChannels = juce::jmin(numChannels, fadeBuffer.getNumChannels());
+    if (fadingEngine != nullptr) {
+        for (int ch=0; ch<numFadeChannels; ch++) {
+            fadeBuffer.copyFrom(ch, 0, buffer, ch, 0, numSamples);
         }
-        
-        // read outBuffer (processed signal) and write to juce buffer
-        channelData[i] = outBuffer[outReadPointer];
-        outReadPointer++;
-        if (outReadPointer >= CBUFFER_SIZE) {
-            outReadPointer = 0;
+        fadingEngine->process(fadeBuffer.getArrayOfWritePointers(), numFadeChannels, numSamples);
+        workerUnderruns += fadingEngine->takeNumUnderruns();
+        telemetry.addStageTimes(fadingEngine->getStageTimes());
+    }
+    
+    activeEngine->process(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+    workerUnderruns += activeEngine->takeNumUnderruns();
+    bytesMovedPerHop.store(activeEngine->getBytesMovedPerHop());
+    telemetry.addStageTimes(activeEngine->getStageTimes());
+    
+    // crossfade over one frame of the new engine
+    if (fadingEngine != nullptr) {
+        const int fadeLength = activeEngine->getConfig().fftSize;
+        const int numToFade = juce::jmin(numSamples, fadeLength - fadePosition);
+        const float startGain = (float) fadePosition / (float) fadeLength;
+        const float endGain = (float) (fadePosition + numToFade) / (float) fadeLength;
+        for (int ch=0; ch<numFadeChannels; ch++) {
+            buffer.applyGainRamp(ch, 0, numToFade, startGain, endGain);
+            buffer.addFromWithRamp(ch, 0, fadeBuffer.getReadPointer(ch), numToFade, 1.0f - startGain, 1.0f - endGain);
+        }
+        fadePosition += numToFade;
+        if (fadePosition >= fadeLength) {
+            retiredEngine.store(fadingEngine.release());
         }
-
     }
     
 }
@@ -193,15 +352,20 @@ juce::AudioProcessorEditor* FftPassthroughAudioProcessor::createEditor()
 //==============================================================================
 void FftPassthroughAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    auto state = parameters.copyState();
+    std::unique_ptr<juce::XmlElement> xml (state.createXml());
+    copyXmlToBinary (*xml, destData);
 }
 
 void FftPassthroughAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    std::unique_ptr<juce::XmlElement> xml (getXmlFromBinary (data, sizeInBytes));
+    if (xml != nullptr && xml->hasTagName (parameters.state.getType()))
+        parameters.replaceState (juce::ValueTree::fromXml (*xml));
+
+    const juce::String impulseFile = parameters.state.getProperty ("impulseResponseFile").toString();
+    if (impulseFile.isNotEmpty())
+        loadImpulseResponse (juce::File (impulseFile));
 }
 
 //==============================================================================
@@ -211,97 +375,161 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new FftPassthroughAudioProcessor();
 }
 
-void FftPassthroughAudioProcessor::processFft() {
+StftConfig FftPassthroughAudioProcessor::getRequestedConfig() const {
+    StftConfig config;
+    const int fftIndex = juce::roundToInt(parameters.getRawParameterValue("fftSize")->load());
+    const int hopIndex = juce::roundToInt(parameters.getRawParameterValue("hopSize")->load());
+    config.fftSize = fftSizeChoices[juce::jlimit(0, juce::numElementsInArray(fftSizeChoices) - 1, fftIndex)];
+    config.hopSize = hopSizeChoices[juce::jlimit(0, juce::numElementsInArray(hopSizeChoices) - 1, hopIndex)];
     
-    // unwrap input circular buffer
-    for (int i=0; i<FFT_SIZE; i++) {
-        inFft[i] = inBuffer[inReadPointer];
-        inReadPointer++;
-        if (inReadPointer >= CBUFFER_SIZE) {
-            inReadPointer = 0;
-        }
+    // keep the frame and hop length in time constant at other sample rates
+    const double sampleRate = currentSampleRate.load();
+    if (parameters.getRawParameterValue("autoScale")->load() >= 0.5f && sampleRate > 0) {
+        const double scale = sampleRate / 48000.0;
+        config.fftSize = juce::jlimit(64, 32768, juce::nextPowerOfTwo(juce::roundToInt(config.fftSize * scale)));
+        config.hopSize = juce::jlimit(16, 8192, juce::nextPowerOfTwo(juce::roundToInt(config.hopSize * scale)));
     }
     
-    computeFft(FFT_SIZE, inFft, outFft);
-    // spectral processing start ------------------------
+    config.window = (WindowType) juce::jlimit(0, 2, juce::roundToInt(parameters.getRawParameterValue("window")->load()));
+    // every hop choice exists at every fft size, but past the window's
+    // largest hop the overlap-add no longer sums to a constant
+    config.hopSize = juce::jmin(config.hopSize, getMaxHopSize(config.window, config.fftSize));
+    config.processor = (SpectralProcessorType) juce::jlimit(0, 3, juce::roundToInt(parameters.getRawParameterValue("processor")->load()));
+    config.scheduling = (FrameScheduling) juce::jlimit(0, 2, juce::roundToInt(parameters.getRawParameterValue("scheduling")->load()));
+    config.packStereoPairs = juce::roundToInt(parameters.getRawParameterValue("stereoTransform")->load()) == 1;
+    // uniformly partitioned overlap-save: partitions of half a frame, and
+    // the hop and window that make the engine keep only the valid outputs
+    if (config.processor == SpectralProcessorType::convolution) {
+        config.hopSize = config.fftSize / 2;
+        config.window = WindowType::overlapSave;
+        std::lock_guard<std::mutex> lock(impulseLock);
+        config.impulseResponse = impulseResponse;
+    }
+    // the worker must have a whole host block to deliver a hop, hops needed
+    // within a block were then queued in an earlier one. before the first
+    // prepareToPlay there is no block size, keep the default.
+    const int bufferSize = currentBufferSize.load();
+    if (bufferSize > 0) {
+        config.workerLatencyHops = (bufferSize + config.hopSize - 1) / config.hopSize + 1;
+    }
+    config.numChannels = numStftChannels;
+    config.backendType = fftBackendType.load();
+    return config;
+}
+
+void FftPassthroughAudioProcessor::updateEngine() {
+    std::lock_guard<std::mutex> lock(engineLock);
     
-    // spectral processing end --------------------------
-    computeIfft(FFT_SIZE, outFft, outIfft);
+    // free what the audio thread has swapped out
+    delete retiredEngine.exchange(nullptr);
     
-    // store outIfft into outBuffer
-    for (int i=0; i<FFT_SIZE; i++) {
-        outBuffer[outWritePointer] = (outIfft[i] / FFT_SIZE);
-        outWritePointer++;
-        if (outWritePointer >= CBUFFER_SIZE) {
-            outWritePointer = 0;
-        }
+    // tell the host once the audio thread has switched to an engine with
+    // another latency
+    const int latency = activeLatency.load();
+    if (isPrepared && latency != getLatencySamples()) {
+        setLatencySamples(latency);
     }
     
+    // one handover at a time
+    if (! isPrepared || pendingEngine.load() != nullptr) {
+        return;
+    }
+    
+    const auto config = getRequestedConfig();
+    if (config == latestConfig) {
+        return;
+    }
+    latestConfig = config;
+    // keep the current engine if the new one can't be set up
+    if (auto engine = createStftEngine(config)) {
+        pendingEngine.store(engine.release());
+    }
 }
 
+void FftPassthroughAudioProcessor::clearPendingEngines() {
+    delete pendingEngine.exchange(nullptr);
+    delete retiredEngine.exchange(nullptr);
+    fadingEngine.reset();
+}
 
-void FftPassthroughAudioProcessor::computeFft(int bufferSize, float* input, std::complex<float>* output) {
-    double* in;
-    fftw_complex* out;
-    fftw_plan p;
-    
-    // allocate mem for in
-    in = (double*) fftw_malloc(sizeof(double) * bufferSize);
-    // copy input to in
-    for (int i=0; i<bufferSize; i++) {
-        in[i] = (double) input[i];
+bool FftPassthroughAudioProcessor::setChoiceParameter(const juce::String& paramId, const juce::String& text) {
+    auto* choice = dynamic_cast<juce::AudioParameterChoice*>(parameters.getParameter(paramId));
+    if (choice == nullptr) {
+        return false;
     }
-    //calculate out size
-    //int n_out = ((bufferSize/2)+1);
-    // allocate mem for out
-    out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * bufferSize);
-    
-    //plan fft
-    p = fftw_plan_dft_r2c_1d(bufferSize, in, out, FFTW_ESTIMATE);
-    //perform fft
-    fftw_execute(p); /* repeat as needed */
-
-    //copy result to output
-    for (int i=0; i<bufferSize; i++) {
-        output[i].real(out[i][0]);
-        output[i].imag(out[i][1]);
+    auto simplify = [] (const juce::String& name) { return name.removeCharacters(" -_").toLowerCase(); };
+    for (int i=0; i<choice->choices.size(); i++) {
+        if (simplify(choice->choices[i]) == simplify(text)) {
+            *choice = i;
+            return true;
+        }
     }
-    
-    // free resources
-    fftw_destroy_plan(p);
-    fftw_free(out);
-    fftw_free(in);
+    return false;
 }
 
-void FftPassthroughAudioProcessor::computeIfft(int bufferSize, std::complex<float>* input, float* output) {
-    double* out;
-    fftw_complex* in;
-    fftw_plan p;
-    
-    //calculate in size
-    //int n_in = ((bufferSize/2)+1);
-    // allocate mem for in
-    in = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * bufferSize);
-    // copy input to in
-    for (int i=0; i<bufferSize; i++) {
-        in[i][0] = input[i].real();
-        in[i][1] = input[i].imag();
+void FftPassthroughAudioProcessor::loadImpulseResponse(const juce::File& file) {
+    {
+        std::lock_guard<std::mutex> lock(impulseLock);
+        pendingImpulseFile = file;
     }
-    // allocate mem for out
-    out = (double*) fftw_malloc(sizeof(double) * bufferSize);
-    
-    //plan ifft
-    p = fftw_plan_dft_c2r_1d(bufferSize, in, out, FFTW_ESTIMATE);
-    //perform fft
-    fftw_execute(p); /* repeat as needed */
-    
-    // copy result to output
-    for (int i=0; i<bufferSize; i++) {
-        output[i] = (float) out[i];
+    parameters.state.setProperty("impulseResponseFile", file.getFullPathName(), nullptr);
+    engineBuilder->notify();
+}
+
+bool FftPassthroughAudioProcessor::setImpulseResponse(const juce::AudioBuffer<float>& samples, double sampleRate) {
+    if (samples.getNumChannels() == 0 || samples.getNumSamples() == 0 || sampleRate <= 0) {
+        return false;
+    }
+    auto source = makeImpulseResponse(samples, sampleRate);
+    for (;;) {
+        // resampled outside the lock, before the first prepareToPlay there
+        // is no rate yet and prepareToPlay resamples it
+        const double rate = currentSampleRate.load();
+        auto resampled = rate > 0 ? resampleImpulseResponse(*source, rate) : nullptr;
+        
+        std::lock_guard<std::mutex> lock(impulseLock);
+        // a prepareToPlay in the meantime may have looked for the old
+        // response already, so resample for its rate
+        if (rate != currentSampleRate.load()) {
+            continue;
+        }
+        sourceImpulse = source;
+        impulseResponse = resampled;
+        impulseFileName = {};
+        return true;
+    }
+}
+
+juce::String FftPassthroughAudioProcessor::getImpulseResponseName() const {
+    std::lock_guard<std::mutex> lock(impulseLock);
+    if (sourceImpulse == nullptr) {
+        return {};
+    }
+    return impulseFileName.isNotEmpty() ? impulseFileName : juce::String("Impulse response");
+}
+
+void FftPassthroughAudioProcessor::loadPendingImpulseResponse() {
+    juce::File file;
+    {
+        std::lock_guard<std::mutex> lock(impulseLock);
+        std::swap(file, pendingImpulseFile);
+    }
+    if (file == juce::File()) {
+        return;
     }
     
-    // free resources
-    fftw_destroy_plan(p);
-    fftw_free(in);
-    fftw_free(out);
+    // reading, resampling and, once the engine is built with it,
+    // transforming the partitions all happen here on the builder thread
+    auto source = readImpulseResponse(file);
+    if (source == nullptr) {
+        return;
+    }
+    if (setImpulseResponse(source->samples, source->sampleRate)) {
+        std::lock_guard<std::mutex> lock(impulseLock);
+        impulseFileName = file.getFileName();
+    }
+}
+
+void FftPassthroughAudioProcessor::setFftBackend(FftBackendType type) {
+    fftBackendType.store(type);
 }
@@ -10,14 +10,15 @@
 
 #include <JuceHeader.h>
 #include <complex>
+#include <mutex>
+#include "StftEngine.h"
+#include "AlignedArena.h"
+#include "DspTelemetry.h"
 
-// fft defines
+// default fft settings, the sizes in use are host automatable parameters
 #define FFT_SIZE 2048
 #define HOP_SIZE 128
 
-// circular buffer defines
-#define CBUFFER_SIZE 2048
-
 //==============================================================================
 /**
 */
@@ -64,30 +65,107 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    void computeFft(int bufferSize, float* input, std::complex<float>* output);
-    void computeIfft(int bufferSize, std::complex<float>* input, float* output);
+    // selects the fft implementation, the engine is rebuilt in the background
+    void setFftBackend(FftBackendType type);
+    FftBackendType getFftBackendType() const { return fftBackendType.load(); }
+    
+    // sets the choice parameter paramId to the choice named text, ignoring
+    // case, spaces and dashes. returns false if there's no such choice.
+    bool setChoiceParameter(const juce::String& paramId, const juce::String& text);
+    
+    // the stft configuration asked for by the current parameter values
+    StftConfig getRequestedConfig() const;
     
-    void processFft();
+    // convolution processor: reads the impulse response in file on the
+    // builder thread, an engine with it then replaces the current one. the
+    // file is remembered in the plugin state. returns at once.
+    void loadImpulseResponse(const juce::File& file);
+    // same for samples already in memory, e.g. from the tools. resamples to
+    // the current rate right away, engines built from here on use it.
+    // returns false for an empty buffer.
+    bool setImpulseResponse(const juce::AudioBuffer<float>& samples, double sampleRate);
+    // file name of the impulse response in use, empty for none
+    juce::String getImpulseResponseName() const;
+    
+    // hops the worker thread didn't keep up with since the plugin was created
+    int getNumWorkerUnderruns() const { return workerUnderruns.load(); }
+    // bytes the active engine moved around for its last frame
+    int getBytesMovedPerHop() const { return bytesMovedPerHop.load(); }
+    // callback and frame stage timing, read by the editor
+    const DspTelemetry& getTelemetry() const { return telemetry; }
+    // magnitude frames of the active engine for the analyzer, read by the editor
+    SpectrumFifo& getSpectrumFifo() { return spectrumFifo; }
+    
+    juce::AudioProcessorValueTreeState parameters;
     
 private:
     
-    float currentBufferSize;
-    float currentSampleRate;
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    
+    // builds engines for new configurations off the audio thread, and frees
+    // the ones the audio thread has swapped out
+    class EngineBuilder;
+    void updateEngine();
+    // reads the file loadImpulseResponse was last given, if any
+    void loadPendingImpulseResponse();
+    // deletes every engine waiting in the handover slots or being faded out
+    void clearPendingEngines();
+    
+    // 0 until the first prepareToPlay. read by the message and builder
+    // threads as well, hence atomic.
+    std::atomic<int> currentBufferSize { 0 };
+    std::atomic<double> currentSampleRate { 0.0 };
+    
+    // number of channels with their own stft state
+    int numStftChannels = 0;
+    
+    std::atomic<FftBackendType> fftBackendType { FftBackendType::automatic };
+    
+    // the convolution's impulse response as loaded and resampled to
+    // currentSampleRate. the engines built with it hold their own references.
+    mutable std::mutex impulseLock;
+    std::shared_ptr<const ImpulseResponse> sourceImpulse;
+    std::shared_ptr<const ImpulseResponse> impulseResponse;
+    juce::String impulseFileName;
+    juce::File pendingImpulseFile;
+    
+    // engine used by processBlock, only touched by the audio thread while playing
+    std::unique_ptr<StftEngine> activeEngine;
+    // previous engine, still processed while it's crossfaded into activeEngine
+    std::unique_ptr<StftEngine> fadingEngine;
+    int fadePosition = 0;
+    // refers to fadeChannels, it never allocates itself
+    juce::AudioBuffer<float> fadeBuffer;
+    std::vector<float*> fadeChannels;
+    
+    // memory of the processor's own buffers, one block sized in prepareToPlay.
+    // the engines carve theirs out of arenas of their own, since they are
+    // built and freed on the builder thread while this one keeps playing.
+    AlignedArena arena;
     
-    // circular input buffer
-    float* inBuffer;
-    int inWritePointer;
-    int inReadPointer;
-    int hopCounter;
+    // latency and tail of the engine in use, set by the audio thread on a swap
+    // and reported to the host from the builder thread
+    std::atomic<int> activeLatency { 0 };
+    std::atomic<int> activeTail { 0 };
+    std::atomic<int> workerUnderruns { 0 };
+    std::atomic<int> bytesMovedPerHop { 0 };
+    DspTelemetry telemetry;
+    SpectrumFifo spectrumFifo;
     
-    // circular output buffer
-    float* outBuffer;
-    int outWritePointer;
-    int outReadPointer;
+    // handover between EngineBuilder and the audio thread: the builder
+    // publishes a ready engine in pendingEngine, the audio thread takes it and
+    // hands the one it replaced back through retiredEngine to be deleted.
+    // the audio thread never allocates, frees or blocks for this.
+    std::atomic<StftEngine*> pendingEngine { nullptr };
+    std::atomic<StftEngine*> retiredEngine { nullptr };
     
-    float* inFft = new float[FFT_SIZE];
-    std::complex<float>* outFft = new std::complex<float>[FFT_SIZE];
-    float* outIfft = new float[FFT_SIZE];
+    // serialises prepareToPlay/releaseResources and the builder thread,
+    // never taken on the audio thread
+    std::mutex engineLock;
+    // config of the newest engine built, active or pending
+    StftConfig latestConfig;
+    bool isPrepared = false;
+    std::unique_ptr<EngineBuilder> engineBuilder;
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FftPassthroughAudioProcessor)
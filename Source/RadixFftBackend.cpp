@@ -0,0 +1,316 @@
+/*
+  ==============================================================================
+
+    RadixFftBackend.cpp
+
+  ==============================================================================
+*/
+
+#include "RadixFftBackend.h"
+#include "FftResourceRegistry.h"
+#include "SimdOps.h"
+
+//==============================================================================
+// the butterfly stages, once per instruction set
+namespace radixfft
+{
+
+namespace scalar
+{
+    using simd::scalar::Wide;
+    using simd::scalar::Quad;
+    #include "RadixFftKernels.h"
+}
+
+#if SIMD_X86
+
+SIMD_BEGIN_TARGET_SSE2
+namespace sse2
+{
+    using simd::sse2::Wide;
+    using simd::sse2::Quad;
+    #include "RadixFftKernels.h"
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_TARGET_AVX2
+namespace avx2
+{
+    using simd::avx2::Wide;
+    using simd::avx2::Quad;
+    #include "RadixFftKernels.h"
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_TARGET_AVX512
+namespace avx512
+{
+    using simd::avx512::Wide;
+    using simd::avx512::Quad;
+    #include "RadixFftKernels.h"
+}
+SIMD_END_TARGET
+
+#endif // SIMD_X86
+
+#if SIMD_NEON
+namespace neon
+{
+    using simd::neon::Wide;
+    using simd::neon::Quad;
+    #include "RadixFftKernels.h"
+}
+#endif // SIMD_NEON
+
+static RadixFftBackend::ComplexTransform getComplexTransform(simd::Isa isa) {
+    if (simd::isAvailable(isa)) {
+        switch (isa) {
+           #if SIMD_X86
+            case simd::Isa::sse2:   return &sse2::complexTransform;
+            case simd::Isa::avx2:   return &avx2::complexTransform;
+            case simd::Isa::avx512: return &avx512::complexTransform;
+           #endif
+           #if SIMD_NEON
+            case simd::Isa::neon:   return &neon::complexTransform;
+           #endif
+            default: break;
+        }
+    }
+    return &scalar::complexTransform;
+}
+
+} // namespace radixfft
+
+//==============================================================================
+RadixFftBackend::RadixFftBackend()
+{
+}
+
+RadixFftBackend::~RadixFftBackend()
+{
+}
+
+void RadixFftBackend::prepare(int fftSize, int numChannels) {
+    // channels are transformed one by one, nothing depends on the count
+    channels = numChannels;
+    if (isPrepared() && fftSize == size) {
+        return;
+    }
+    jassert(fftSize >= 4 && (fftSize & (fftSize - 1)) == 0);
+    complexTransform = radixfft::getComplexTransform(simd::getBestIsa());
+
+    size = fftSize;
+    half = size / 2;
+
+    // the tables only depend on the size, one set is shared process wide
+    FftResourceKey key;
+    key.kind = FftResourceKind::radixTables;
+    key.fftSize = size;
+    key.precision = (int) sizeof(float);
+    key.backend = FftBackendType::radix;
+    tables = FftResourceRegistry::getInstance().getOrCreate<Tables>(key, [this] {
+        return std::make_shared<Tables>(size);
+    });
+
+    // the pair transforms run the complex transform at the full size
+    workRe.assign(size, 0.0f);
+    workIm.assign(size, 0.0f);
+}
+
+void RadixFftBackend::release() {
+    size = 0;
+    channels = 0;
+    half = 0;
+    tables = nullptr;
+    workRe = {};
+    workIm = {};
+}
+
+//==============================================================================
+RadixFftBackend::Tables::Tables(int size) {
+    const int half = size / 2;
+    const double twoPi = 6.283185307179586476925286766559;
+
+    // bit reversal tables for the half size and the full size complex transform
+    auto createBitReverse = [] (int n) {
+        int numBits = 0;
+        while ((1 << numBits) < n) {
+            numBits++;
+        }
+        std::vector<int> table(n);
+        for (int i=0; i<n; i++) {
+            int r = 0;
+            for (int b=0; b<numBits; b++) {
+                r |= ((i >> b) & 1) << (numBits - 1 - b);
+            }
+            table[i] = r;
+        }
+        return table;
+    };
+    bitReverse = createBitReverse(half);
+    pairBitReverse = createBitReverse(size);
+
+    // per stage twiddles, stored one stage after the other. the half size
+    // transform stops before the last stage, only the pair transforms use it.
+    for (int span=2; span<=size; span<<=1) {
+        for (int j=0; j<span/2; j++) {
+            stageTwiddlesRe.push_back((float) std::cos(twoPi * j / span));
+            stageTwiddlesIm.push_back((float) -std::sin(twoPi * j / span));
+        }
+    }
+
+    splitTwiddlesRe.resize(half);
+    splitTwiddlesIm.resize(half);
+    for (int k=0; k<half; k++) {
+        splitTwiddlesRe[k] = (float) std::cos(twoPi * k / size);
+        splitTwiddlesIm[k] = (float) -std::sin(twoPi * k / size);
+    }
+}
+
+size_t RadixFftBackend::Tables::getNumBytes() const {
+    return sizeof(int) * (bitReverse.size() + pairBitReverse.size())
+         + sizeof(float) * (stageTwiddlesRe.size() + stageTwiddlesIm.size() + splitTwiddlesRe.size() + splitTwiddlesIm.size());
+}
+
+//==============================================================================
+void RadixFftBackend::performComplexTransform(int n) {
+    complexTransform(workRe.data(), workIm.data(), n, tables->stageTwiddlesRe.data(), tables->stageTwiddlesIm.data());
+}
+
+void RadixFftBackend::forward(const float* input, std::complex<float>* output) {
+    float* bins = reinterpret_cast<float*>(output);
+    forwardStrided(input, bins, bins + 1, 2);
+}
+
+void RadixFftBackend::inverse(const std::complex<float>* input, float* output) {
+    const float* bins = reinterpret_cast<const float*>(input);
+    inverseStrided(bins, bins + 1, output, 2);
+}
+
+void RadixFftBackend::forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) {
+    for (int ch=0; ch<numChannels; ch++) {
+        forwardStrided(input + ch * size, real + ch * binStride, imag + ch * binStride, 1);
+    }
+}
+
+void RadixFftBackend::inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) {
+    for (int ch=0; ch<numChannels; ch++) {
+        inverseStrided(real + ch * binStride, imag + ch * binStride, output + ch * size, 1);
+    }
+}
+
+void RadixFftBackend::forwardStrided(const float* input, float* real, float* imag, int binStep) {
+    jassert(isPrepared());
+    const int* bitReverse = tables->bitReverse.data();
+    const float* splitTwiddlesRe = tables->splitTwiddlesRe.data();
+    const float* splitTwiddlesIm = tables->splitTwiddlesIm.data();
+
+    // pack even/odd samples as one complex signal, already bit reversed
+    for (int k=0; k<half; k++) {
+        workRe[bitReverse[k]] = input[2 * k];
+        workIm[bitReverse[k]] = input[2 * k + 1];
+    }
+
+    performComplexTransform(half);
+
+    // split step: X[k] = E[k] - i * W^k * O[k], with
+    // E = (Z[k] + conj(Z[half-k])) / 2 and O = (Z[k] - conj(Z[half-k])) / 2
+    real[0] = workRe[0] + workIm[0];
+    imag[0] = 0.0f;
+    real[half * binStep] = workRe[0] - workIm[0];
+    imag[half * binStep] = 0.0f;
+    for (int k=1; k<half; k++) {
+        const float zRe = workRe[k];
+        const float zIm = workIm[k];
+        const float cRe = workRe[half - k];
+        const float cIm = -workIm[half - k];
+
+        const float eRe = 0.5f * (zRe + cRe);
+        const float eIm = 0.5f * (zIm + cIm);
+        const float oRe = 0.5f * (zRe - cRe);
+        const float oIm = 0.5f * (zIm - cIm);
+
+        const float wRe = splitTwiddlesRe[k];
+        const float wIm = splitTwiddlesIm[k];
+        real[k * binStep] = eRe + (wRe * oIm + wIm * oRe);
+        imag[k * binStep] = eIm - (wRe * oRe - wIm * oIm);
+    }
+}
+
+void RadixFftBackend::inverseStrided(const float* real, const float* imag, float* output, int binStep) {
+    jassert(isPrepared());
+    const int* bitReverse = tables->bitReverse.data();
+    const float* splitTwiddlesRe = tables->splitTwiddlesRe.data();
+    const float* splitTwiddlesIm = tables->splitTwiddlesIm.data();
+
+    // merge step: Z[k] = E[k] + i * conj(W^k) * O[k], with
+    // E = X[k] + conj(X[half-k]) and O = X[k] - conj(X[half-k]). the missing
+    // 1/2 makes the result come out unscaled like fftw. the inverse complex
+    // transform is done as conj(fft(conj(Z))), so the imaginary part is
+    // stored negated, straight into bit reversed order.
+    for (int k=0; k<half; k++) {
+        const float xRe = real[k * binStep];
+        const float xIm = imag[k * binStep];
+        const float cRe = real[(half - k) * binStep];
+        const float cIm = -imag[(half - k) * binStep];
+
+        const float eRe = xRe + cRe;
+        const float eIm = xIm + cIm;
+        const float dRe = xRe - cRe;
+        const float dIm = xIm - cIm;
+
+        const float wRe = splitTwiddlesRe[k];
+        const float wIm = -splitTwiddlesIm[k];
+        const float oRe = dRe * wRe - dIm * wIm;
+        const float oIm = dRe * wIm + dIm * wRe;
+
+        workRe[bitReverse[k]] = eRe - oIm;
+        workIm[bitReverse[k]] = -(eIm + oRe);
+    }
+
+    performComplexTransform(half);
+
+    for (int k=0; k<half; k++) {
+        output[2 * k] = workRe[k];
+        output[2 * k + 1] = -workIm[k];
+    }
+}
+
+void RadixFftBackend::forwardPair(const float* input, float* real, float* imag, int binStride) {
+    jassert(isPrepared());
+    const int* order = tables->pairBitReverse.data();
+
+    // first channel in the real part, second in the imaginary part
+    const float* second = input + size;
+    for (int i=0; i<size; i++) {
+        workRe[order[i]] = input[i];
+        workIm[order[i]] = second[i];
+    }
+
+    performComplexTransform(size);
+    separatePair(workRe.data(), workIm.data(), 1, size, real, imag, binStride);
+}
+
+void RadixFftBackend::inversePair(float* real, float* imag, float* output, int binStride) {
+    jassert(isPrepared());
+    const int* order = tables->pairBitReverse.data();
+
+    // the inverse is done as conj(fft(conj(Z))) like inverseStrided. Z is
+    // built in the output frames, which are overwritten anyway, and copied
+    // from there into bit reversed order with its imaginary part negated.
+    float* zRe = output;
+    float* zIm = output + size;
+    combinePair(real, imag, binStride, size, zRe, zIm, 1);
+    for (int k=0; k<size; k++) {
+        workRe[order[k]] = zRe[k];
+        workIm[order[k]] = -zIm[k];
+    }
+
+    performComplexTransform(size);
+
+    float* second = output + size;
+    for (int i=0; i<size; i++) {
+        output[i] = workRe[i];
+        second[i] = -workIm[i];
+    }
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    RadixFftBackend.h
+
+    Self-contained real FFT for any power of two size, no external library
+    needed. A real transform of size N is computed as a complex transform of
+    size N/2 (even samples in the real part, odd samples in the imaginary
+    part) followed by a split step that separates the two half spectra.
+
+    The complex transform is radix-4 where it can and radix-2 for the last
+    stage of odd powers of two, not split-radix: split-radix saves a few
+    percent of the multiplies but its L-shaped butterflies don't map onto
+    whole vectors the way two radix-2 stages per pass do. Data is kept as
+    separate real and imaginary arrays and every stage reads its twiddles
+    from a contiguous table, and the passes in RadixFftKernels.h run them
+    with the vector types of SimdOps.h, on the widest instruction set the
+    cpu has. The split step stays scalar. For 64 to 8192 points the fixed
+    size kernels (FixedSizeFftBackend) are faster still, this backend covers
+    the other sizes and is the fallback of every other backend.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "FftBackend.h"
+#include <vector>
+
+//==============================================================================
+class RadixFftBackend : public FftBackend
+{
+public:
+    RadixFftBackend();
+    ~RadixFftBackend() override;
+
+    const char* getName() const override { return "radix"; }
+
+    void prepare(int fftSize, int numChannels) override;
+    void release() override;
+
+    bool isPrepared() const override { return tables != nullptr; }
+    int getSize() const override { return size; }
+    int getNumChannels() const override { return channels; }
+
+    void forward(const float* input, std::complex<float>* output) override;
+    void inverse(const std::complex<float>* input, float* output) override;
+    void forwardSplit(const float* input, float* real, float* imag, int numChannels, int binStride) override;
+    void inverseSplit(float* real, float* imag, float* output, int numChannels, int binStride) override;
+    // one full size complex transform for both channels
+    void forwardPair(const float* input, float* real, float* imag, int binStride) override;
+    void inversePair(float* real, float* imag, float* output, int binStride) override;
+
+private:
+    // one real transform between input/output and bins whose real and
+    // imaginary parts are binStep floats apart from one bin to the next.
+    // interleaved complex bins are binStep 2, split arrays binStep 1.
+    void forwardStrided(const float* input, float* real, float* imag, int binStep);
+    void inverseStrided(const float* real, const float* imag, float* output, int binStep);
+
+public:
+    // the complex transform of RadixFftKernels.h for one instruction set
+    using ComplexTransform = void (*)(float* re, float* im, int n, const float* twiddlesRe, const float* twiddlesIm);
+
+private:
+    // in-place complex forward transform of n samples in the work buffers,
+    // half for the real transforms and size for the pair ones. expects its
+    // input in bit reversed order and leaves the result in natural order.
+    void performComplexTransform(int n);
+
+    int size = 0;
+    int channels = 0;
+    int half = 0;
+
+    // immutable tables for one size, shared by every radix backend of that
+    // size through FftResourceRegistry
+    struct Tables
+    {
+        explicit Tables(int size);
+        size_t getNumBytes() const;
+
+        // bit reversal of the half size and the full size transform
+        std::vector<int> bitReverse, pairBitReverse;
+        // twiddles of all butterfly stages up to the full size, stage with
+        // span 2h uses h entries
+        std::vector<float> stageTwiddlesRe, stageTwiddlesIm;
+        // exp(-2*pi*i*k/size) for the real split step, k in [0, half)
+        std::vector<float> splitTwiddlesRe, splitTwiddlesIm;
+    };
+    std::shared_ptr<const Tables> tables;
+    ComplexTransform complexTransform = nullptr;
+
+    // per instance scratch for the complex transform
+    std::vector<float> workRe, workIm;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RadixFftBackend)
+};
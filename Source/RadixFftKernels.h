@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    RadixFftKernels.h
+
+    The butterfly stages of RadixFftBackend, written once against the vector
+    types Wide and Quad for any power of two size. No include guard on
+    purpose: RadixFftBackend.cpp includes this inside one namespace per
+    instruction set, don't include it anywhere else.
+
+  ==============================================================================
+*/
+
+// stages of half span h and 2h in one pass over n points, like
+// FixedSizeFftKernels.h but with the size known at run time. with a0..a3
+// the points j, j+h, j+2h and j+3h of a group of 4h: the first stage pairs
+// (a0, a1) and (a2, a3) with w1 = W(2h)^j, the second (b0, b2) with
+// w2 = W(4h)^j and (b1, b3) with W(4h)^(j+h), which is -i * w2.
+// Ops::width must divide h.
+template <typename Ops>
+inline void radixFourPass(float* re, float* im, int n, int h, const float* w1Re, const float* w1Im,
+                          const float* w2Re, const float* w2Im) {
+    using V = typename Ops::V;
+    for (int start=0; start<n; start+=4*h) {
+        float* r0 = re + start;
+        float* i0 = im + start;
+        for (int j=0; j<h; j+=Ops::width) {
+            const V a0r = Ops::load(r0 + j),         a0i = Ops::load(i0 + j);
+            const V a1r = Ops::load(r0 + h + j),     a1i = Ops::load(i0 + h + j);
+            const V a2r = Ops::load(r0 + 2 * h + j), a2i = Ops::load(i0 + 2 * h + j);
+            const V a3r = Ops::load(r0 + 3 * h + j), a3i = Ops::load(i0 + 3 * h + j);
+            const V w1r = Ops::load(w1Re + j), w1i = Ops::load(w1Im + j);
+            const V w2r = Ops::load(w2Re + j), w2i = Ops::load(w2Im + j);
+
+            const V tr = Ops::sub(Ops::mul(a1r, w1r), Ops::mul(a1i, w1i));
+            const V ti = Ops::add(Ops::mul(a1r, w1i), Ops::mul(a1i, w1r));
+            const V b0r = Ops::add(a0r, tr), b0i = Ops::add(a0i, ti);
+            const V b1r = Ops::sub(a0r, tr), b1i = Ops::sub(a0i, ti);
+
+            const V ur = Ops::sub(Ops::mul(a3r, w1r), Ops::mul(a3i, w1i));
+            const V ui = Ops::add(Ops::mul(a3r, w1i), Ops::mul(a3i, w1r));
+            const V b2r = Ops::add(a2r, ur), b2i = Ops::add(a2i, ui);
+            const V b3r = Ops::sub(a2r, ur), b3i = Ops::sub(a2i, ui);
+
+            const V vr = Ops::sub(Ops::mul(b2r, w2r), Ops::mul(b2i, w2i));
+            const V vi = Ops::add(Ops::mul(b2r, w2i), Ops::mul(b2i, w2r));
+            const V xr = Ops::sub(Ops::mul(b3r, w2r), Ops::mul(b3i, w2i));
+            const V xi = Ops::add(Ops::mul(b3r, w2i), Ops::mul(b3i, w2r));
+
+            Ops::store(r0 + j, Ops::add(b0r, vr));         Ops::store(i0 + j, Ops::add(b0i, vi));
+            Ops::store(r0 + 2 * h + j, Ops::sub(b0r, vr)); Ops::store(i0 + 2 * h + j, Ops::sub(b0i, vi));
+            // b1 -+ i * x
+            Ops::store(r0 + h + j, Ops::add(b1r, xi));     Ops::store(i0 + h + j, Ops::sub(b1i, xr));
+            Ops::store(r0 + 3 * h + j, Ops::sub(b1r, xi)); Ops::store(i0 + 3 * h + j, Ops::add(b1i, xr));
+        }
+    }
+}
+
+// the single stage of half span h left over when n is an odd power of two
+template <typename Ops>
+inline void radixTwoPass(float* re, float* im, int n, int h, const float* wRe, const float* wIm) {
+    using V = typename Ops::V;
+    for (int start=0; start<n; start+=2*h) {
+        float* aRe = re + start;
+        float* aIm = im + start;
+        float* bRe = aRe + h;
+        float* bIm = aIm + h;
+        for (int j=0; j<h; j+=Ops::width) {
+            const V br = Ops::load(bRe + j), bi = Ops::load(bIm + j);
+            const V wr = Ops::load(wRe + j), wi = Ops::load(wIm + j);
+            const V tr = Ops::sub(Ops::mul(br, wr), Ops::mul(bi, wi));
+            const V ti = Ops::add(Ops::mul(br, wi), Ops::mul(bi, wr));
+            const V ar = Ops::load(aRe + j), ai = Ops::load(aIm + j);
+            Ops::store(bRe + j, Ops::sub(ar, tr)); Ops::store(bIm + j, Ops::sub(ai, ti));
+            Ops::store(aRe + j, Ops::add(ar, tr)); Ops::store(aIm + j, Ops::add(ai, ti));
+        }
+    }
+}
+
+// in-place complex forward transform of n points from bit reversed to
+// natural order. the stage of half span h reads its h twiddles W(2h)^j from
+// offset h - 1 of the stage tables. the passes use the widest of Wide and
+// Quad that divides h.
+inline void complexTransform(float* re, float* im, int n, const float* twiddlesRe, const float* twiddlesIm) {
+    int h = 1;
+    for (; 2*h<n; h*=4) {
+        const float* w1Re = twiddlesRe + h - 1;
+        const float* w1Im = twiddlesIm + h - 1;
+        const float* w2Re = twiddlesRe + 2 * h - 1;
+        const float* w2Im = twiddlesIm + 2 * h - 1;
+        if (h >= Wide::width) {
+            radixFourPass<Wide>(re, im, n, h, w1Re, w1Im, w2Re, w2Im);
+        } else if (h >= Quad::width) {
+            radixFourPass<Quad>(re, im, n, h, w1Re, w1Im, w2Re, w2Im);
+        } else {
+            radixFourPass<simd::Scalar>(re, im, n, h, w1Re, w1Im, w2Re, w2Im);
+        }
+    }
+    if (h < n) {
+        if (h >= Wide::width) {
+            radixTwoPass<Wide>(re, im, n, h, twiddlesRe + h - 1, twiddlesIm + h - 1);
+        } else if (h >= Quad::width) {
+            radixTwoPass<Quad>(re, im, n, h, twiddlesRe + h - 1, twiddlesIm + h - 1);
+        } else {
+            radixTwoPass<simd::Scalar>(re, im, n, h, twiddlesRe + h - 1, twiddlesIm + h - 1);
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    RealtimeAllocationGuard.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeAllocationGuard.h"
+
+#if FFT_TRAP_REALTIME_ALLOCATIONS || FFT_COUNT_ALLOCATIONS
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+//==============================================================================
+namespace
+{
+    thread_local bool isGuarded = false;
+    thread_local juce::int64 numAllocations = 0;
+
+    void trapIfGuarded(const char* what) {
+        if (FFT_TRAP_REALTIME_ALLOCATIONS && isGuarded) {
+            // lift the guard first, reporting may allocate
+            isGuarded = false;
+            std::fprintf(stderr, "%s on the audio thread inside processBlock\n", what);
+            std::fflush(stderr);
+            jassertfalse;
+            std::abort();
+        }
+    }
+}
+
+#if FFT_TRAP_REALTIME_ALLOCATIONS
+ScopedRealtimeAllocationGuard::ScopedRealtimeAllocationGuard()
+    : wasGuarded(isGuarded)
+{
+    isGuarded = true;
+}
+
+ScopedRealtimeAllocationGuard::~ScopedRealtimeAllocationGuard()
+{
+    isGuarded = wasGuarded;
+}
+#endif
+
+juce::int64 getNumAllocationsOnThisThread() {
+    return FFT_COUNT_ALLOCATIONS ? numAllocations : -1;
+}
+
+//==============================================================================
+// the array and nothrow forms end up in these
+void* operator new(std::size_t size) {
+    trapIfGuarded("operator new");
+    numAllocations++;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    if (p != nullptr) {
+        trapIfGuarded("operator delete");
+    }
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+#else
+
+juce::int64 getNumAllocationsOnThisThread() {
+    return -1;
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    RealtimeAllocationGuard.h
+
+    Debug check that the audio thread stays off the heap. While a
+    ScopedRealtimeAllocationGuard is alive on a thread, any operator new or
+    delete called on that thread (std containers, juce::String,
+    make_unique...) prints what happened and aborts, so a regression fails
+    the first run that hits it instead of glitching now and then.
+    processBlock holds one for its whole duration. Memory taken straight
+    from malloc (juce::HeapBlock) isn't seen by the check.
+
+    The same replacement operators can also just count, for tools that
+    report allocations per callback instead of stopping at the first one.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// on in debug builds. replaces the global operator new and delete, set
+// FFT_TRAP_REALTIME_ALLOCATIONS=0 where that isn't wanted.
+#ifndef FFT_TRAP_REALTIME_ALLOCATIONS
+ #if JUCE_DEBUG
+  #define FFT_TRAP_REALTIME_ALLOCATIONS 1
+ #else
+  #define FFT_TRAP_REALTIME_ALLOCATIONS 0
+ #endif
+#endif
+
+// counts operator new calls per thread, see getNumAllocationsOnThisThread.
+// also replaces the global operators, on wherever trapping is.
+#ifndef FFT_COUNT_ALLOCATIONS
+ #define FFT_COUNT_ALLOCATIONS FFT_TRAP_REALTIME_ALLOCATIONS
+#endif
+
+//==============================================================================
+class ScopedRealtimeAllocationGuard
+{
+public:
+   #if FFT_TRAP_REALTIME_ALLOCATIONS
+    ScopedRealtimeAllocationGuard();
+    ~ScopedRealtimeAllocationGuard();
+
+private:
+    // guards nest, the outermost one lifts the check
+    bool wasGuarded;
+   #else
+    ScopedRealtimeAllocationGuard() {}
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedRealtimeAllocationGuard)
+};
+
+// operator new calls made by the calling thread so far, or -1 when the
+// build doesn't count them
+juce::int64 getNumAllocationsOnThisThread();
@@ -0,0 +1,317 @@
+/*
+  ==============================================================================
+
+    SimdOps.h
+
+    The vector types the header-only kernels (FixedSizeFft.h, SpectralOps.h)
+    are written against, and the run-time choice between them. Every
+    instruction set gets a namespace with a struct Wide, its widest float
+    vector, and Quad, a vector of four floats; Scalar does one float at a
+    time, for plain c++ and loop tails. All of them have the same static
+    functions, so a kernel templated on the ops compiles for any of them.
+
+    A kernel library includes its kernels once per instruction set, between
+    SIMD_BEGIN_TARGET_xxx and SIMD_END_TARGET, so the compiler may use the
+    instructions in them whatever the flags of the rest of the build. Which
+    one runs is then picked with getBestIsa() at run time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define SIMD_X86 1
+ #include <immintrin.h>
+#else
+ #define SIMD_X86 0
+#endif
+
+// 64 bit arm only, armv7 neon has no vector divide and square root
+#if defined(__aarch64__) || defined(_M_ARM64)
+ #define SIMD_NEON 1
+ #include <arm_neon.h>
+#else
+ #define SIMD_NEON 0
+#endif
+
+// enables an instruction set for the functions up to SIMD_END_TARGET. msvc
+// compiles intrinsics anywhere, it needs no switch.
+#if defined(__clang__)
+ #define SIMD_BEGIN_TARGET_SSE2   _Pragma("clang attribute push (__attribute__((target(\"sse2\"))), apply_to = function)")
+ #define SIMD_BEGIN_TARGET_AVX2   _Pragma("clang attribute push (__attribute__((target(\"avx2\"))), apply_to = function)")
+ #define SIMD_BEGIN_TARGET_AVX512 _Pragma("clang attribute push (__attribute__((target(\"avx512f\"))), apply_to = function)")
+ #define SIMD_END_TARGET          _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+ #define SIMD_BEGIN_TARGET_SSE2   _Pragma("GCC push_options") _Pragma("GCC target (\"sse2\")")
+ #define SIMD_BEGIN_TARGET_AVX2   _Pragma("GCC push_options") _Pragma("GCC target (\"avx2\")")
+ #define SIMD_BEGIN_TARGET_AVX512 _Pragma("GCC push_options") _Pragma("GCC target (\"avx512f\")")
+ #define SIMD_END_TARGET          _Pragma("GCC pop_options")
+#else
+ #define SIMD_BEGIN_TARGET_SSE2
+ #define SIMD_BEGIN_TARGET_AVX2
+ #define SIMD_BEGIN_TARGET_AVX512
+ #define SIMD_END_TARGET
+#endif
+
+namespace simd
+{
+
+//==============================================================================
+enum class Isa
+{
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+    neon
+};
+
+// every instruction set, narrowest first
+constexpr Isa allIsas[] = { Isa::scalar, Isa::sse2, Isa::avx2, Isa::avx512, Isa::neon };
+
+inline const char* getIsaName(Isa isa) {
+    switch (isa) {
+        case Isa::scalar: return "scalar";
+        case Isa::sse2:   return "sse2";
+        case Isa::avx2:   return "avx2";
+        case Isa::avx512: return "avx512";
+        case Isa::neon:   return "neon";
+    }
+    return "";
+}
+
+// whether the kernels for isa are compiled in and the cpu runs them
+inline bool isAvailable(Isa isa) {
+    switch (isa) {
+        case Isa::scalar: return true;
+       #if SIMD_X86
+        case Isa::sse2:   return juce::SystemStats::hasSSE2();
+        case Isa::avx2:   return juce::SystemStats::hasAVX2();
+        case Isa::avx512: return juce::SystemStats::hasAVX512F();
+       #endif
+       #if SIMD_NEON
+        case Isa::neon:   return true;
+       #endif
+        default: break;
+    }
+    return false;
+}
+
+// the widest instruction set available, looked up once
+inline Isa getBestIsa() {
+    static const Isa best = [] {
+        for (auto isa : { Isa::avx512, Isa::avx2, Isa::sse2, Isa::neon }) {
+            if (isAvailable(isa)) {
+                return isa;
+            }
+        }
+        return Isa::scalar;
+    }();
+    return best;
+}
+
+//==============================================================================
+// one float at a time. comparisons give a Mask that select() takes.
+struct Scalar
+{
+    using V = float;
+    using Mask = bool;
+    static constexpr int width = 1;
+
+    static V load(const float* p) { return *p; }
+    static void store(float* p, V v) { *p = v; }
+    static V set(float x) { return x; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static V sqrt(V v) { return std::sqrt(v); }
+    static V min(V a, V b) { return std::min(a, b); }
+    static V max(V a, V b) { return std::max(a, b); }
+    static V abs(V v) { return std::abs(v); }
+    static Mask lessThan(V a, V b) { return a < b; }
+    static V select(Mask m, V ifTrue, V ifFalse) { return m ? ifTrue : ifFalse; }
+    static V reverse(V v) { return v; }
+};
+
+namespace scalar
+{
+    using Quad = Scalar;
+    using Wide = Scalar;
+}
+
+#if SIMD_X86
+
+SIMD_BEGIN_TARGET_SSE2
+namespace sse2
+{
+    struct Quad
+    {
+        using V = __m128;
+        using Mask = __m128;
+        static constexpr int width = 4;
+
+        static V load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+        static V set(float x) { return _mm_set1_ps(x); }
+        static V add(V a, V b) { return _mm_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm_div_ps(a, b); }
+        static V sqrt(V v) { return _mm_sqrt_ps(v); }
+        static V min(V a, V b) { return _mm_min_ps(a, b); }
+        static V max(V a, V b) { return _mm_max_ps(a, b); }
+        static V abs(V v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+        static Mask lessThan(V a, V b) { return _mm_cmplt_ps(a, b); }
+        static V select(Mask m, V ifTrue, V ifFalse) { return _mm_or_ps(_mm_and_ps(m, ifTrue), _mm_andnot_ps(m, ifFalse)); }
+        static V reverse(V v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3)); }
+    };
+    using Wide = Quad;
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_TARGET_AVX2
+namespace avx2
+{
+    // vex encoded, no sse/avx transition penalties next to Wide
+    struct Quad
+    {
+        using V = __m128;
+        using Mask = __m128;
+        static constexpr int width = 4;
+
+        static V load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+        static V set(float x) { return _mm_set1_ps(x); }
+        static V add(V a, V b) { return _mm_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm_div_ps(a, b); }
+        static V sqrt(V v) { return _mm_sqrt_ps(v); }
+        static V min(V a, V b) { return _mm_min_ps(a, b); }
+        static V max(V a, V b) { return _mm_max_ps(a, b); }
+        static V abs(V v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+        static Mask lessThan(V a, V b) { return _mm_cmplt_ps(a, b); }
+        static V select(Mask m, V ifTrue, V ifFalse) { return _mm_blendv_ps(ifFalse, ifTrue, m); }
+        static V reverse(V v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3)); }
+    };
+    struct Wide
+    {
+        using V = __m256;
+        using Mask = __m256;
+        static constexpr int width = 8;
+
+        static V load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+        static V set(float x) { return _mm256_set1_ps(x); }
+        static V add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm256_div_ps(a, b); }
+        static V sqrt(V v) { return _mm256_sqrt_ps(v); }
+        static V min(V a, V b) { return _mm256_min_ps(a, b); }
+        static V max(V a, V b) { return _mm256_max_ps(a, b); }
+        static V abs(V v) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v); }
+        static Mask lessThan(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static V select(Mask m, V ifTrue, V ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, m); }
+        static V reverse(V v) { return _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)); }
+    };
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_TARGET_AVX512
+namespace avx512
+{
+    struct Quad
+    {
+        using V = __m128;
+        using Mask = __m128;
+        static constexpr int width = 4;
+
+        static V load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+        static V set(float x) { return _mm_set1_ps(x); }
+        static V add(V a, V b) { return _mm_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm_div_ps(a, b); }
+        static V sqrt(V v) { return _mm_sqrt_ps(v); }
+        static V min(V a, V b) { return _mm_min_ps(a, b); }
+        static V max(V a, V b) { return _mm_max_ps(a, b); }
+        static V abs(V v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+        static Mask lessThan(V a, V b) { return _mm_cmplt_ps(a, b); }
+        static V select(Mask m, V ifTrue, V ifFalse) { return _mm_blendv_ps(ifFalse, ifTrue, m); }
+        static V reverse(V v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3)); }
+    };
+    struct Wide
+    {
+        using V = __m512;
+        using Mask = __mmask16;
+        static constexpr int width = 16;
+
+        static V load(const float* p) { return _mm512_loadu_ps(p); }
+        static void store(float* p, V v) { _mm512_storeu_ps(p, v); }
+        static V set(float x) { return _mm512_set1_ps(x); }
+        static V add(V a, V b) { return _mm512_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm512_div_ps(a, b); }
+        // like reverse below, the zero-masking forms keep gcc 12's
+        // uninitialized warnings out of the kernels at no cost
+        static V sqrt(V v) { return _mm512_maskz_sqrt_ps((Mask) 0xffff, v); }
+        static V min(V a, V b) { return _mm512_maskz_min_ps((Mask) 0xffff, a, b); }
+        static V max(V a, V b) { return _mm512_maskz_max_ps((Mask) 0xffff, a, b); }
+        static V abs(V v) { return _mm512_abs_ps(v); }
+        static Mask lessThan(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+        static V select(Mask m, V ifTrue, V ifFalse) { return _mm512_mask_blend_ps(m, ifFalse, ifTrue); }
+        // the zero-masking form with every lane set is the same vpermps, but
+        // doesn't merge into gcc's self-initialised _mm512_undefined_ps,
+        // which gcc 12 warns about wherever it's inlined
+        static V reverse(V v) {
+            return _mm512_maskz_permutexvar_ps((Mask) 0xffff, _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), v);
+        }
+    };
+}
+SIMD_END_TARGET
+
+#endif // SIMD_X86
+
+#if SIMD_NEON
+// part of every arm64 cpu, no target switch needed
+namespace neon
+{
+    struct Quad
+    {
+        using V = float32x4_t;
+        using Mask = uint32x4_t;
+        static constexpr int width = 4;
+
+        static V load(const float* p) { return vld1q_f32(p); }
+        static void store(float* p, V v) { vst1q_f32(p, v); }
+        static V set(float x) { return vdupq_n_f32(x); }
+        static V add(V a, V b) { return vaddq_f32(a, b); }
+        static V sub(V a, V b) { return vsubq_f32(a, b); }
+        static V mul(V a, V b) { return vmulq_f32(a, b); }
+        static V div(V a, V b) { return vdivq_f32(a, b); }
+        static V sqrt(V v) { return vsqrtq_f32(v); }
+        static V min(V a, V b) { return vminq_f32(a, b); }
+        static V max(V a, V b) { return vmaxq_f32(a, b); }
+        static V abs(V v) { return vabsq_f32(v); }
+        static Mask lessThan(V a, V b) { return vcltq_f32(a, b); }
+        static V select(Mask m, V ifTrue, V ifFalse) { return vbslq_f32(m, ifTrue, ifFalse); }
+        static V reverse(V v) {
+            const float32x4_t swapped = vrev64q_f32(v);
+            return vcombine_f32(vget_high_f32(swapped), vget_low_f32(swapped));
+        }
+    };
+    using Wide = Quad;
+}
+#endif // SIMD_NEON
+
+} // namespace simd
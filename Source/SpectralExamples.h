@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    SpectralExamples.h
+
+    Two small spectral processors, as examples of the SpectralProcessor hook.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SpectralProcessor.h"
+#include "SpectralOps.h"
+
+//==============================================================================
+// keeps the magnitude of every bin and zeroes its phase. with hops of a few
+// ms this gives the classic robot voice, pitched at sampleRate / hopSize.
+class RobotizeProcessor : public SpectralProcessor<RobotizeProcessor>
+{
+public:
+    void processSpectrum(SpectrumSpan spectrum, int, juce::int64) {
+        spectralops::magnitude(spectrum.real, spectrum.imag, spectrum.real, spectrum.numBins);
+        juce::FloatVectorOperations::clear(spectrum.imag, spectrum.numBins);
+    }
+};
+
+//==============================================================================
+// zeroes every bin more than thresholdDb below the loudest bin of its frame
+// and channel, a crude noise reduction that keeps only the strong partials
+class SpectralGateProcessor : public SpectralProcessor<SpectralGateProcessor>
+{
+public:
+    static constexpr float thresholdDb = -40.0f;
+
+    void processSpectrum(SpectrumSpan spectrum, int, juce::int64) {
+        // compare squared magnitudes, no square roots per bin
+        const float peak = spectralops::getPeakPower(spectrum.real, spectrum.imag, spectrum.numBins);
+        const float threshold = peak * juce::Decibels::decibelsToGain(thresholdDb * 2.0f);
+        spectralops::gate(spectrum.real, spectrum.imag, threshold, spectrum.numBins);
+    }
+};
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    SpectralFrame.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectralFrame.h"
+
+//==============================================================================
+void SpectralFrame::setSize(int fftSize, int numChannels) {
+    channels = numChannels;
+    numBins = fftSize / 2 + 1;
+    paddedNumBins = getPaddedNumBins(fftSize);
+
+    storage.allocate((size_t) (channels * getChannelStride()));
+    data = storage.get();
+}
+
+void SpectralFrame::setSize(int fftSize, int numChannels, float* memory) {
+    jassert(reinterpret_cast<uintptr_t>(memory) % (simdFloats * sizeof(float)) == 0);
+    channels = numChannels;
+    numBins = fftSize / 2 + 1;
+    paddedNumBins = getPaddedNumBins(fftSize);
+
+    storage.allocate(0);
+    data = memory;
+}
+
+void SpectralFrame::clear() {
+    if (data != nullptr) {
+        juce::FloatVectorOperations::clear(data, channels * getChannelStride());
+    }
+}
+
+void SpectralFrame::copyFrom(int channel, const std::complex<float>* bins) {
+    float* re = getReal(channel);
+    float* im = getImag(channel);
+    for (int k=0; k<numBins; k++) {
+        re[k] = bins[k].real();
+        im[k] = bins[k].imag();
+    }
+}
+
+void SpectralFrame::copyTo(int channel, std::complex<float>* bins) const {
+    const float* re = getReal(channel);
+    const float* im = getImag(channel);
+    for (int k=0; k<numBins; k++) {
+        bins[k] = { re[k], im[k] };
+    }
+}
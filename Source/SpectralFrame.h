@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    SpectralFrame.h
+
+    The half spectrum of one stft frame for every channel, stored as split
+    real and imaginary arrays (structure of arrays) so per-bin code runs as
+    plain unit-stride float loops. Only the fftSize/2+1 unique bins of a real
+    transform are kept, padded to a multiple of the simd width, and every
+    array starts on a simd aligned address.
+
+    Channel ch keeps its real parts at getReal(ch) and its imaginary parts
+    getPaddedNumBins() floats further on, so both arrays of consecutive
+    channels are getChannelStride() floats apart. FftBackend::forwardSplit
+    and inverseSplit take that stride, fftw plans it through its guru split
+    interface.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+#include "SpectralProcessor.h"
+#include "AlignedBuffer.h"
+
+//==============================================================================
+class SpectralFrame
+{
+public:
+    // 64 bytes, enough for avx-512
+    static constexpr int simdFloats = 16;
+
+    SpectralFrame() = default;
+    SpectralFrame(int fftSize, int numChannels) { setSize(fftSize, numChannels); }
+
+    // allocates a cleared frame. not real-time safe.
+    void setSize(int fftSize, int numChannels);
+    // uses getNumFloats(fftSize, numChannels) floats at memory instead,
+    // which must be simd aligned and outlive the frame
+    void setSize(int fftSize, int numChannels, float* memory);
+    void clear();
+
+    int getNumChannels() const { return channels; }
+    int getNumBins() const { return numBins; }
+    int getPaddedNumBins() const { return paddedNumBins; }
+    int getChannelStride() const { return 2 * paddedNumBins; }
+
+    float* getReal(int channel) { return data + channel * getChannelStride(); }
+    float* getImag(int channel) { return getReal(channel) + paddedNumBins; }
+    const float* getReal(int channel) const { return data + channel * getChannelStride(); }
+    const float* getImag(int channel) const { return getReal(channel) + paddedNumBins; }
+
+    SpectrumSpan getChannel(int channel) { return { getReal(channel), getImag(channel), numBins }; }
+
+    // conversions to and from interleaved complex bins, the layout of
+    // std::complex<float> arrays and fftwf_complex
+    void copyFrom(int channel, const std::complex<float>* bins);
+    void copyTo(int channel, std::complex<float>* bins) const;
+
+    // padded bin count and channel stride a frame of fftSize uses, for
+    // buffers that share its layout
+    static int getPaddedNumBins(int fftSize) { return (fftSize / 2 + 1 + simdFloats - 1) / simdFloats * simdFloats; }
+    static int getChannelStride(int fftSize) { return 2 * getPaddedNumBins(fftSize); }
+    static int getNumFloats(int fftSize, int numChannels) { return numChannels * getChannelStride(fftSize); }
+
+private:
+    int channels = 0;
+    int numBins = 0;
+    int paddedNumBins = 0;
+
+    AlignedBuffer<float> storage;
+    float* data = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralFrame)
+};
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    SpectralOps.h
+
+    Header-only kernels for the per-bin work of spectral processors, over
+    whole frames of split spectra (a SpectrumSpan, or any arrays of the same
+    layout): magnitude and power, cartesian to polar and back, per-bin gain
+    curves and gating, complex multiply and multiply-add, min/max and
+    recursive smoothing of magnitude frames, and the peak power of a frame.
+
+    Like FixedSizeFft.h, the kernels are compiled once per instruction set
+    from SpectralOpsKernels.h, and the functions below run the widest one the
+    cpu has. Every kernel takes any number of bins, does the whole vectors
+    first and the rest one bin at a time with the same arithmetic, and does
+    nothing but loads, stores and math: no allocation, safe on the audio
+    thread. Outputs may alias inputs of the same bin (out = in), never a
+    shifted one.
+
+    toPolar and fromPolar use polynomial approximations of atan2 and sin/cos,
+    within 3e-7 for phases of up to 1e5 radians on every instruction set.
+    Past that the range reduction loses precision quickly, so accumulated
+    phases should be wrapped now and then.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SimdOps.h"
+#include <limits>
+
+namespace spectralops
+{
+
+//==============================================================================
+// every kernel of one instruction set
+struct Kernels
+{
+    simd::Isa isa;
+
+    // sqrt(re^2 + im^2)
+    void (*magnitude)(const float* real, const float* imag, float* magnitude, int numBins);
+    // re^2 + im^2
+    void (*power)(const float* real, const float* imag, float* power, int numBins);
+    // magnitude and phase in [-pi, pi]
+    void (*toPolar)(const float* real, const float* imag, float* magnitude, float* phase, int numBins);
+    void (*fromPolar)(const float* magnitude, const float* phase, float* real, float* imag, int numBins);
+    // scales bin k by gain[k]
+    void (*applyGain)(float* real, float* imag, const float* gain, int numBins);
+    // zeroes every bin with a power below threshold
+    void (*gate)(float* real, float* imag, float threshold, int numBins);
+    // out = a * b, complex
+    void (*multiply)(const float* aRe, const float* aIm, const float* bRe, const float* bIm,
+                     float* outRe, float* outIm, int numBins);
+    // y += a * b, complex
+    void (*multiplyAdd)(float* yRe, float* yIm, const float* aRe, const float* aIm,
+                        const float* bRe, const float* bIm, int numBins);
+    // per bin minimum and maximum of two real frames, e.g. magnitude floors
+    // and peak holds
+    void (*minimum)(const float* a, const float* b, float* out, int numBins);
+    void (*maximum)(const float* a, const float* b, float* out, int numBins);
+    // state += coefficient * (input - state), a one pole lowpass per bin
+    // across frames
+    void (*smooth)(float* state, const float* input, float coefficient, int numBins);
+    // the largest re^2 + im^2 of the frame, 0 for no bins
+    float (*getPeakPower)(const float* real, const float* imag, int numBins);
+};
+
+//==============================================================================
+namespace scalar
+{
+    using simd::scalar::Wide;
+    constexpr simd::Isa isa = simd::Isa::scalar;
+    #include "SpectralOpsKernels.h"
+}
+
+#if SIMD_X86
+
+SIMD_BEGIN_TARGET_SSE2
+namespace sse2
+{
+    using simd::sse2::Wide;
+    constexpr simd::Isa isa = simd::Isa::sse2;
+    #include "SpectralOpsKernels.h"
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_TARGET_AVX2
+namespace avx2
+{
+    using simd::avx2::Wide;
+    constexpr simd::Isa isa = simd::Isa::avx2;
+    #include "SpectralOpsKernels.h"
+}
+SIMD_END_TARGET
+
+SIMD_BEGIN_TARGET_AVX512
+namespace avx512
+{
+    using simd::avx512::Wide;
+    constexpr simd::Isa isa = simd::Isa::avx512;
+    #include "SpectralOpsKernels.h"
+}
+SIMD_END_TARGET
+
+#endif // SIMD_X86
+
+#if SIMD_NEON
+namespace neon
+{
+    using simd::neon::Wide;
+    constexpr simd::Isa isa = simd::Isa::neon;
+    #include "SpectralOpsKernels.h"
+}
+#endif // SIMD_NEON
+
+//==============================================================================
+// the kernels of isa, the scalar ones if the cpu can't run it
+inline const Kernels& getKernels(simd::Isa isa) {
+    if (simd::isAvailable(isa)) {
+        switch (isa) {
+           #if SIMD_X86
+            case simd::Isa::sse2:   return sse2::kernels;
+            case simd::Isa::avx2:   return avx2::kernels;
+            case simd::Isa::avx512: return avx512::kernels;
+           #endif
+           #if SIMD_NEON
+            case simd::Isa::neon:   return neon::kernels;
+           #endif
+            default: break;
+        }
+    }
+    return scalar::kernels;
+}
+
+// the kernels of the widest instruction set, looked up once. the first call
+// reads the cpu features, which may allocate, so make it off the audio
+// thread (createStftEngine does)
+inline const Kernels& getKernels() {
+    static const Kernels& best = getKernels(simd::getBestIsa());
+    return best;
+}
+
+//==============================================================================
+inline void magnitude(const float* real, const float* imag, float* magnitude, int numBins) {
+    getKernels().magnitude(real, imag, magnitude, numBins);
+}
+
+inline void power(const float* real, const float* imag, float* power, int numBins) {
+    getKernels().power(real, imag, power, numBins);
+}
+
+inline void toPolar(const float* real, const float* imag, float* magnitude, float* phase, int numBins) {
+    getKernels().toPolar(real, imag, magnitude, phase, numBins);
+}
+
+inline void fromPolar(const float* magnitude, const float* phase, float* real, float* imag, int numBins) {
+    getKernels().fromPolar(magnitude, phase, real, imag, numBins);
+}
+
+inline void applyGain(float* real, float* imag, const float* gain, int numBins) {
+    getKernels().applyGain(real, imag, gain, numBins);
+}
+
+inline void gate(float* real, float* imag, float threshold, int numBins) {
+    getKernels().gate(real, imag, threshold, numBins);
+}
+
+inline void multiply(const float* aRe, const float* aIm, const float* bRe, const float* bIm,
+                     float* outRe, float* outIm, int numBins) {
+    getKernels().multiply(aRe, aIm, bRe, bIm, outRe, outIm, numBins);
+}
+
+inline void multiplyAdd(float* yRe, float* yIm, const float* aRe, const float* aIm,
+                        const float* bRe, const float* bIm, int numBins) {
+    getKernels().multiplyAdd(yRe, yIm, aRe, aIm, bRe, bIm, numBins);
+}
+
+inline void minimum(const float* a, const float* b, float* out, int numBins) {
+    getKernels().minimum(a, b, out, numBins);
+}
+
+inline void maximum(const float* a, const float* b, float* out, int numBins) {
+    getKernels().maximum(a, b, out, numBins);
+}
+
+inline void smooth(float* state, const float* input, float coefficient, int numBins) {
+    getKernels().smooth(state, input, coefficient, numBins);
+}
+
+inline float getPeakPower(const float* real, const float* imag, int numBins) {
+    return getKernels().getPeakPower(real, imag, numBins);
+}
+
+} // namespace spectralops
@@ -0,0 +1,316 @@
+/*
+  ==============================================================================
+
+    SpectralOpsKernels.h
+
+    The kernels of SpectralOps.h, written once against the vector type Wide
+    and simd::Scalar for the bins past the last whole vector. No include
+    guard on purpose: SpectralOps.h includes this inside one namespace per
+    instruction set, with isa defined, don't include it anywhere else.
+
+  ==============================================================================
+*/
+
+// atan2 as cephes atanf: the smaller of |x| and |y| over the larger is in
+// [0, 1], above tan(pi/8) it is moved below by atan(a) = pi/4 +
+// atan((a-1)/(a+1)), and a polynomial does the rest. the octant restores
+// the angle. about 2 ulp; the origin gives 0, -0 counts as positive.
+template <typename Ops>
+inline typename Ops::V atan2At(typename Ops::V y, typename Ops::V x) {
+    using V = typename Ops::V;
+    const V zero = Ops::set(0.0f);
+    const V one = Ops::set(1.0f);
+    const V ax = Ops::abs(x);
+    const V ay = Ops::abs(y);
+    const V a = Ops::div(Ops::min(ax, ay), Ops::max(Ops::max(ax, ay), Ops::set(std::numeric_limits<float>::min())));
+
+    const auto upper = Ops::lessThan(Ops::set(0.414213562f), a);
+    const V t = Ops::select(upper, Ops::div(Ops::sub(a, one), Ops::add(a, one)), a);
+    const V z = Ops::mul(t, t);
+    V p = Ops::set(8.05374449538e-2f);
+    p = Ops::add(Ops::mul(p, z), Ops::set(-1.38776856032e-1f));
+    p = Ops::add(Ops::mul(p, z), Ops::set(1.99777106478e-1f));
+    p = Ops::add(Ops::mul(p, z), Ops::set(-3.33329491539e-1f));
+    V angle = Ops::add(Ops::select(upper, Ops::set(0.785398163f), zero),
+                       Ops::add(t, Ops::mul(Ops::mul(t, z), p)));
+
+    angle = Ops::select(Ops::lessThan(ax, ay), Ops::sub(Ops::set(1.570796327f), angle), angle);
+    angle = Ops::select(Ops::lessThan(x, zero), Ops::sub(Ops::set(3.141592654f), angle), angle);
+    return Ops::select(Ops::lessThan(y, zero), Ops::sub(zero, angle), angle);
+}
+
+// nearest integer of |v| < 2^22, by the rounding of an add. no sse4.1 round
+// needed, and the same in every instruction set.
+template <typename Ops>
+inline typename Ops::V roundAt(typename Ops::V v) {
+    const auto magic = Ops::set(12582912.0f);
+    return Ops::sub(Ops::add(v, magic), magic);
+}
+
+template <typename Ops>
+inline typename Ops::V floorAt(typename Ops::V v) {
+    const auto rounded = roundAt<Ops>(v);
+    return Ops::sub(rounded, Ops::select(Ops::lessThan(v, rounded), Ops::set(1.0f), Ops::set(0.0f)));
+}
+
+// sin and cos as cephes sinf/cosf: x less the nearest multiple j of pi/2,
+// then a polynomial each over [-pi/4, pi/4], swapped and negated by the
+// quadrant j mod 4. pi/2 is split Cody-Waite style into three parts of 8
+// significant bits and a float rest, so j times each of the first three is
+// exact while |j| < 2^16 without relying on an fma, which not every
+// instruction set has. within 2e-7 for |x| up to 1e5, past that the
+// products start rounding and the error grows quickly with |x|.
+template <typename Ops>
+inline void sinCosAt(typename Ops::V x, typename Ops::V& sine, typename Ops::V& cosine) {
+    using V = typename Ops::V;
+    const V one = Ops::set(1.0f);
+    const V two = Ops::set(2.0f);
+    const V j = roundAt<Ops>(Ops::mul(x, Ops::set(0.636619772f)));
+    V r = Ops::sub(x, Ops::mul(j, Ops::set(1.5703125f)));
+    r = Ops::sub(r, Ops::mul(j, Ops::set(4.825592041015625e-4f)));
+    r = Ops::sub(r, Ops::mul(j, Ops::set(1.2665987014770508e-6f)));
+    r = Ops::sub(r, Ops::mul(j, Ops::set(9.920936294705029e-10f)));
+    const V z = Ops::mul(r, r);
+
+    V s = Ops::set(-1.9515295891e-4f);
+    s = Ops::add(Ops::mul(s, z), Ops::set(8.3321608736e-3f));
+    s = Ops::add(Ops::mul(s, z), Ops::set(-1.6666654611e-1f));
+    s = Ops::add(r, Ops::mul(Ops::mul(r, z), s));
+
+    V c = Ops::set(2.443315711809948e-5f);
+    c = Ops::add(Ops::mul(c, z), Ops::set(-1.388731625493765e-3f));
+    c = Ops::add(Ops::mul(c, z), Ops::set(4.166664568298827e-2f));
+    c = Ops::add(Ops::sub(one, Ops::mul(Ops::set(0.5f), z)), Ops::mul(Ops::mul(z, z), c));
+
+    // quadrant q in 0..3 as its two bits: odd swaps sin and cos, sin is
+    // negative in the upper half, cos where exactly one bit is set
+    const V q = Ops::sub(j, Ops::mul(Ops::set(4.0f), floorAt<Ops>(Ops::mul(j, Ops::set(0.25f)))));
+    const V upper = floorAt<Ops>(Ops::mul(q, Ops::set(0.5f)));
+    const V odd = Ops::sub(q, Ops::mul(two, upper));
+    const V cosNegative = Ops::sub(Ops::add(odd, upper), Ops::mul(two, Ops::mul(odd, upper)));
+    const auto swap = Ops::lessThan(Ops::set(0.5f), odd);
+    sine = Ops::mul(Ops::select(swap, c, s), Ops::sub(one, Ops::mul(two, upper)));
+    cosine = Ops::mul(Ops::select(swap, s, c), Ops::sub(one, Ops::mul(two, cosNegative)));
+}
+
+//==============================================================================
+// one vector of Ops::width bins from bin k on, per kernel
+template <typename Ops>
+inline void magnitudeAt(const float* real, const float* imag, float* magnitude, int k) {
+    const auto re = Ops::load(real + k);
+    const auto im = Ops::load(imag + k);
+    Ops::store(magnitude + k, Ops::sqrt(Ops::add(Ops::mul(re, re), Ops::mul(im, im))));
+}
+
+template <typename Ops>
+inline void powerAt(const float* real, const float* imag, float* power, int k) {
+    const auto re = Ops::load(real + k);
+    const auto im = Ops::load(imag + k);
+    Ops::store(power + k, Ops::add(Ops::mul(re, re), Ops::mul(im, im)));
+}
+
+template <typename Ops>
+inline void toPolarAt(const float* real, const float* imag, float* magnitude, float* phase, int k) {
+    const auto re = Ops::load(real + k);
+    const auto im = Ops::load(imag + k);
+    Ops::store(magnitude + k, Ops::sqrt(Ops::add(Ops::mul(re, re), Ops::mul(im, im))));
+    Ops::store(phase + k, atan2At<Ops>(im, re));
+}
+
+template <typename Ops>
+inline void fromPolarAt(const float* magnitude, const float* phase, float* real, float* imag, int k) {
+    typename Ops::V sine, cosine;
+    sinCosAt<Ops>(Ops::load(phase + k), sine, cosine);
+    const auto m = Ops::load(magnitude + k);
+    Ops::store(real + k, Ops::mul(m, cosine));
+    Ops::store(imag + k, Ops::mul(m, sine));
+}
+
+template <typename Ops>
+inline void applyGainAt(float* real, float* imag, const float* gain, int k) {
+    const auto g = Ops::load(gain + k);
+    Ops::store(real + k, Ops::mul(Ops::load(real + k), g));
+    Ops::store(imag + k, Ops::mul(Ops::load(imag + k), g));
+}
+
+template <typename Ops>
+inline void gateAt(float* real, float* imag, typename Ops::V threshold, int k) {
+    const auto re = Ops::load(real + k);
+    const auto im = Ops::load(imag + k);
+    const auto below = Ops::lessThan(Ops::add(Ops::mul(re, re), Ops::mul(im, im)), threshold);
+    const auto zero = Ops::set(0.0f);
+    Ops::store(real + k, Ops::select(below, zero, re));
+    Ops::store(imag + k, Ops::select(below, zero, im));
+}
+
+template <typename Ops>
+inline void multiplyAt(const float* aRe, const float* aIm, const float* bRe, const float* bIm,
+                       float* outRe, float* outIm, int k) {
+    const auto ar = Ops::load(aRe + k), ai = Ops::load(aIm + k);
+    const auto br = Ops::load(bRe + k), bi = Ops::load(bIm + k);
+    Ops::store(outRe + k, Ops::sub(Ops::mul(ar, br), Ops::mul(ai, bi)));
+    Ops::store(outIm + k, Ops::add(Ops::mul(ar, bi), Ops::mul(ai, br)));
+}
+
+template <typename Ops>
+inline void multiplyAddAt(float* yRe, float* yIm, const float* aRe, const float* aIm,
+                          const float* bRe, const float* bIm, int k) {
+    const auto ar = Ops::load(aRe + k), ai = Ops::load(aIm + k);
+    const auto br = Ops::load(bRe + k), bi = Ops::load(bIm + k);
+    Ops::store(yRe + k, Ops::add(Ops::load(yRe + k), Ops::sub(Ops::mul(ar, br), Ops::mul(ai, bi))));
+    Ops::store(yIm + k, Ops::add(Ops::load(yIm + k), Ops::add(Ops::mul(ar, bi), Ops::mul(ai, br))));
+}
+
+template <typename Ops>
+inline void minimumAt(const float* a, const float* b, float* out, int k) {
+    Ops::store(out + k, Ops::min(Ops::load(a + k), Ops::load(b + k)));
+}
+
+template <typename Ops>
+inline void maximumAt(const float* a, const float* b, float* out, int k) {
+    Ops::store(out + k, Ops::max(Ops::load(a + k), Ops::load(b + k)));
+}
+
+template <typename Ops>
+inline void smoothAt(float* state, const float* input, typename Ops::V coefficient, int k) {
+    const auto s = Ops::load(state + k);
+    Ops::store(state + k, Ops::add(s, Ops::mul(coefficient, Ops::sub(Ops::load(input + k), s))));
+}
+
+//==============================================================================
+// the kernels, whole vectors then the remaining bins one at a time
+inline void magnitude(const float* real, const float* imag, float* magnitude, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        magnitudeAt<Wide>(real, imag, magnitude, k);
+    }
+    for (; k<numBins; k++) {
+        magnitudeAt<simd::Scalar>(real, imag, magnitude, k);
+    }
+}
+
+inline void power(const float* real, const float* imag, float* power, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        powerAt<Wide>(real, imag, power, k);
+    }
+    for (; k<numBins; k++) {
+        powerAt<simd::Scalar>(real, imag, power, k);
+    }
+}
+
+inline void toPolar(const float* real, const float* imag, float* magnitude, float* phase, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        toPolarAt<Wide>(real, imag, magnitude, phase, k);
+    }
+    for (; k<numBins; k++) {
+        toPolarAt<simd::Scalar>(real, imag, magnitude, phase, k);
+    }
+}
+
+inline void fromPolar(const float* magnitude, const float* phase, float* real, float* imag, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        fromPolarAt<Wide>(magnitude, phase, real, imag, k);
+    }
+    for (; k<numBins; k++) {
+        fromPolarAt<simd::Scalar>(magnitude, phase, real, imag, k);
+    }
+}
+
+inline void applyGain(float* real, float* imag, const float* gain, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        applyGainAt<Wide>(real, imag, gain, k);
+    }
+    for (; k<numBins; k++) {
+        applyGainAt<simd::Scalar>(real, imag, gain, k);
+    }
+}
+
+inline void gate(float* real, float* imag, float threshold, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        gateAt<Wide>(real, imag, Wide::set(threshold), k);
+    }
+    for (; k<numBins; k++) {
+        gateAt<simd::Scalar>(real, imag, threshold, k);
+    }
+}
+
+inline void multiply(const float* aRe, const float* aIm, const float* bRe, const float* bIm,
+                     float* outRe, float* outIm, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        multiplyAt<Wide>(aRe, aIm, bRe, bIm, outRe, outIm, k);
+    }
+    for (; k<numBins; k++) {
+        multiplyAt<simd::Scalar>(aRe, aIm, bRe, bIm, outRe, outIm, k);
+    }
+}
+
+inline void multiplyAdd(float* yRe, float* yIm, const float* aRe, const float* aIm,
+                        const float* bRe, const float* bIm, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        multiplyAddAt<Wide>(yRe, yIm, aRe, aIm, bRe, bIm, k);
+    }
+    for (; k<numBins; k++) {
+        multiplyAddAt<simd::Scalar>(yRe, yIm, aRe, aIm, bRe, bIm, k);
+    }
+}
+
+inline void minimum(const float* a, const float* b, float* out, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        minimumAt<Wide>(a, b, out, k);
+    }
+    for (; k<numBins; k++) {
+        minimumAt<simd::Scalar>(a, b, out, k);
+    }
+}
+
+inline void maximum(const float* a, const float* b, float* out, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        maximumAt<Wide>(a, b, out, k);
+    }
+    for (; k<numBins; k++) {
+        maximumAt<simd::Scalar>(a, b, out, k);
+    }
+}
+
+inline void smooth(float* state, const float* input, float coefficient, int numBins) {
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        smoothAt<Wide>(state, input, Wide::set(coefficient), k);
+    }
+    for (; k<numBins; k++) {
+        smoothAt<simd::Scalar>(state, input, coefficient, k);
+    }
+}
+
+// one running maximum per lane, folded at the end
+inline float getPeakPower(const float* real, const float* imag, int numBins) {
+    auto peak = Wide::set(0.0f);
+    int k = 0;
+    for (; k + Wide::width <= numBins; k+=Wide::width) {
+        const auto re = Wide::load(real + k);
+        const auto im = Wide::load(imag + k);
+        peak = Wide::max(peak, Wide::add(Wide::mul(re, re), Wide::mul(im, im)));
+    }
+    float lanes[Wide::width];
+    Wide::store(lanes, peak);
+    float result = 0.0f;
+    for (int i=0; i<Wide::width; i++) {
+        result = std::max(result, lanes[i]);
+    }
+    for (; k<numBins; k++) {
+        result = std::max(result, real[k] * real[k] + imag[k] * imag[k]);
+    }
+    return result;
+}
+
+inline constexpr Kernels kernels { isa, &magnitude, &power, &toPolar, &fromPolar, &applyGain, &gate,
+                                   &multiply, &multiplyAdd, &minimum, &maximum, &smooth, &getPeakPower };
@@ -0,0 +1,20 @@
+/*
+  ==============================================================================
+
+    SpectralProcessor.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectralProcessor.h"
+
+//==============================================================================
+const char* getSpectralProcessorName(SpectralProcessorType type) {
+    switch (type) {
+        case SpectralProcessorType::passthrough:  return "Passthrough";
+        case SpectralProcessorType::robotize:     return "Robotize";
+        case SpectralProcessorType::spectralGate: return "Spectral Gate";
+        case SpectralProcessorType::convolution:  return "Convolution";
+    }
+    return "";
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    SpectralProcessor.h
+
+    The hook for per-bin work on every stft frame. A spectral processor is a
+    class deriving from SpectralProcessor<Itself> (crtp) that implements
+
+        void processSpectrum(SpectrumSpan spectrum, int channel, juce::int64 frameTime);
+
+    and optionally hides prepare(), configure() and reset(). The stft engine is a template on the
+    processor type, so processSpectrum is called directly and inlined into the
+    frame loop, without a virtual call or std::function per frame.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct StftConfig;
+class FftBackend;
+
+//==============================================================================
+// the half spectrum of one channel, fftSize/2+1 bins from dc to nyquist,
+// unscaled as returned by the forward transform. real and imaginary parts
+// are separate simd aligned arrays, see SpectralFrame.
+struct SpectrumSpan
+{
+    float* real;
+    float* imag;
+    int numBins;
+
+    int size() const { return numBins; }
+};
+
+//==============================================================================
+template <typename Derived>
+class SpectralProcessor
+{
+public:
+    // called once when the engine is built, off the audio thread
+    void prepare(int fftSize, int hopSize, int numChannels) {
+        juce::ignoreUnused(fftSize, hopSize, numChannels);
+    }
+
+    // called after prepare with the engine's whole configuration and its
+    // prepared fft backend, for processors that precompute spectra of their
+    // own. also off the audio thread.
+    void configure(const StftConfig& config, FftBackend& backend) {
+        juce::ignoreUnused(config, backend);
+    }
+
+    // called whenever the engine clears its buffers, on the thread calling
+    // StftEngine::reset. must not allocate.
+    void reset() {}
+
+    // called by the engine for every channel of every frame. frameTime is the
+    // number of input samples the engine had received when the frame was
+    // taken, so it grows by hopSize from one frame to the next.
+    void processChannel(SpectrumSpan spectrum, int channel, juce::int64 frameTime) {
+        static_cast<Derived*>(this)->processSpectrum(spectrum, channel, frameTime);
+    }
+};
+
+//==============================================================================
+// leaves the spectrum untouched, the engine reduces to analysis/resynthesis
+class NullSpectralProcessor : public SpectralProcessor<NullSpectralProcessor>
+{
+public:
+    void processSpectrum(SpectrumSpan, int, juce::int64) {}
+};
+
+//==============================================================================
+// the processors an engine can be built with, the engine is explicitly
+// instantiated for each of them
+enum class SpectralProcessorType
+{
+    passthrough,    // NullSpectralProcessor
+    robotize,       // RobotizeProcessor
+    spectralGate,   // SpectralGateProcessor
+    convolution     // ConvolutionProcessor
+};
+
+const char* getSpectralProcessorName(SpectralProcessorType type);
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzerComponent.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyzerComponent.h"
+
+//==============================================================================
+SpectrumAnalyzerComponent::SpectrumAnalyzerComponent (SpectrumFifo& f)
+    : fifo (f),
+      latestLevels ((size_t) SpectrumFifo::numBands, SpectrumFifo::floorDb),
+      pulledLevels ((size_t) SpectrumFifo::numBands),
+      spectrogram (juce::Image::RGB, numColumns, SpectrumFifo::numBands, true)
+{
+    // dark blue through red to yellow
+    for (int i=0; i<256; i++) {
+        const float level = i / 255.0f;
+        colourMap[i] = juce::Colour::fromHSV (0.66f - 0.5f * level, 0.9f, juce::jmin (1.0f, 0.1f + 1.5f * level), 1.0f);
+    }
+    setOpaque (true);
+    startTimerHz (30);
+}
+
+SpectrumAnalyzerComponent::~SpectrumAnalyzerComponent()
+{
+}
+
+void SpectrumAnalyzerComponent::timerCallback()
+{
+    bool gotFrame = false;
+    while (fifo.pull (pulledLevels.data())) {
+        addColumn (pulledLevels.data());
+        gotFrame = true;
+    }
+    if (gotFrame) {
+        std::swap (latestLevels, pulledLevels);
+        repaint();
+    }
+}
+
+void SpectrumAnalyzerComponent::addColumn (const float* levels)
+{
+    // lowest band at the bottom
+    juce::Image::BitmapData pixels (spectrogram, writeColumn, 0, 1, SpectrumFifo::numBands, juce::Image::BitmapData::writeOnly);
+    for (int b=0; b<SpectrumFifo::numBands; b++) {
+        const int index = juce::jlimit (0, 255, (int) (255.0f * (1.0f - levels[b] / SpectrumFifo::floorDb)));
+        pixels.setPixelColour (0, SpectrumFifo::numBands - 1 - b, colourMap[index]);
+    }
+    writeColumn = (writeColumn + 1) % numColumns;
+}
+
+//==============================================================================
+void SpectrumAnalyzerComponent::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colours::black);
+    auto area = getLocalBounds();
+    paintSpectrum (g, area.removeFromTop (area.getHeight() / 2));
+    paintSpectrogram (g, area);
+}
+
+float SpectrumAnalyzerComponent::getFrequencyX (double frequency, juce::Rectangle<int> area) const
+{
+    // band b starts at bin (numBins - 1)^(b / numBands)
+    const double binWidth = fifo.getSampleRate() / fifo.getFftSize();
+    const double numBins = fifo.getFftSize() / 2 + 1;
+    const double position = std::log (frequency / binWidth) / std::log (numBins - 1.0);
+    return area.getX() + (float) position * area.getWidth();
+}
+
+void SpectrumAnalyzerComponent::paintSpectrum (juce::Graphics& g, juce::Rectangle<int> area)
+{
+    auto levelToY = [area] (float db) {
+        return juce::jmap (db, SpectrumFifo::floorDb, 0.0f, (float) area.getBottom(), (float) area.getY());
+    };
+
+    // grid: every 20 dB, and decades of frequency
+    g.setColour (juce::Colours::darkgrey);
+    g.setFont (10.0f);
+    for (float db = -20.0f; db > SpectrumFifo::floorDb; db -= 20.0f) {
+        g.drawHorizontalLine (juce::roundToInt (levelToY (db)), (float) area.getX(), (float) area.getRight());
+    }
+    for (double frequency : { 100.0, 1000.0, 10000.0 }) {
+        const float x = getFrequencyX (frequency, area);
+        if (x > area.getX() && x < area.getRight()) {
+            g.drawVerticalLine (juce::roundToInt (x), (float) area.getY(), (float) area.getBottom());
+            g.drawText (frequency >= 1000.0 ? juce::String (frequency / 1000.0) + "k" : juce::String (frequency),
+                        juce::roundToInt (x) + 2, area.getY(), 40, 12, juce::Justification::left);
+        }
+    }
+
+    juce::Path line;
+    const float step = (float) area.getWidth() / (SpectrumFifo::numBands - 1);
+    line.startNewSubPath ((float) area.getX(), levelToY (latestLevels[0]));
+    for (int b=1; b<SpectrumFifo::numBands; b++) {
+        line.lineTo (area.getX() + b * step, levelToY (latestLevels[(size_t) b]));
+    }
+    g.setColour (juce::Colours::lightgreen);
+    g.strokePath (line, juce::PathStrokeType (1.5f));
+}
+
+void SpectrumAnalyzerComponent::paintSpectrogram (juce::Graphics& g, juce::Rectangle<int> area)
+{
+    // the image is drawn rotated from ring order: oldest columns (from the
+    // write position on) on the left, newest on the right
+    g.setImageResamplingQuality (juce::Graphics::lowResamplingQuality);
+    const float scale = (float) area.getWidth() / numColumns;
+    const int numOld = numColumns - writeColumn;
+    g.drawImage (spectrogram, area.getX(), area.getY(), juce::roundToInt (numOld * scale), area.getHeight(),
+                 writeColumn, 0, numOld, SpectrumFifo::numBands);
+    if (writeColumn > 0) {
+        const int x = area.getX() + juce::roundToInt (numOld * scale);
+        g.drawImage (spectrogram, x, area.getY(), area.getRight() - x, area.getHeight(),
+                     0, 0, writeColumn, SpectrumFifo::numBands);
+    }
+}
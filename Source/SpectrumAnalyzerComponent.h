@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzerComponent.h
+
+    Spectrum line and scrolling spectrogram of the frames the active engine
+    sends through a SpectrumFifo. The spectrogram is a cached image one
+    column per frame wide: new frames are written into it as single columns
+    at a moving write position, and paint only blits it, in two parts so the
+    newest column ends up on the right. Nothing is repainted while no frames
+    come in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "SpectrumFifo.h"
+
+//==============================================================================
+class SpectrumAnalyzerComponent  : public juce::Component,
+                                   private juce::Timer
+{
+public:
+    explicit SpectrumAnalyzerComponent (SpectrumFifo& fifo);
+    ~SpectrumAnalyzerComponent() override;
+
+    void paint (juce::Graphics&) override;
+
+private:
+    void timerCallback() override;
+    // writes one frame as the next column of the spectrogram
+    void addColumn (const float* levels);
+
+    void paintSpectrum (juce::Graphics&, juce::Rectangle<int> area);
+    void paintSpectrogram (juce::Graphics&, juce::Rectangle<int> area);
+    // x position of a frequency in area, on the log axis of the bands
+    float getFrequencyX (double frequency, juce::Rectangle<int> area) const;
+
+    // frames of history the spectrogram keeps
+    static constexpr int numColumns = 512;
+
+    SpectrumFifo& fifo;
+    std::vector<float> latestLevels, pulledLevels;
+
+    juce::Image spectrogram;
+    int writeColumn = 0;
+    // level to colour, SpectrumFifo::floorDb .. 0 dB in 256 steps
+    juce::Colour colourMap[256];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzerComponent)
+};
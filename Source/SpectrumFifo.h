@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    SpectrumFifo.h
+
+    Lock free queue of decimated magnitude frames from the stft engines to
+    the editor's analyzer. A frame is numBands levels in dB on a log
+    frequency axis, from the first bin above dc up to nyquist.
+
+    The reading side is the message thread. Writers are whichever thread
+    runs an engine's frames, and during an engine swap two engines write for
+    a moment, so a writer that finds another one busy, or the queue full,
+    drops its frame instead of waiting. Nothing is allocated after
+    construction.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+class SpectrumFifo
+{
+public:
+    static constexpr int numBands = 256;
+    static constexpr int capacity = 32;
+    // level shown as silence
+    static constexpr float floorDb = -120.0f;
+
+    SpectrumFifo() : fifo(capacity), frames((size_t) (capacity * numBands)) {}
+
+    // any writer thread, never blocks. false if the frame was dropped.
+    template <typename FillFunction>
+    bool push(FillFunction&& fill) {
+        if (writing.test_and_set(std::memory_order_acquire)) {
+            return false;
+        }
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 > 0) {
+            fill(frames.data() + start1 * numBands);
+            fifo.finishedWrite(1);
+        }
+        writing.clear(std::memory_order_release);
+        return size1 > 0;
+    }
+
+    // message thread: copies the oldest frame to dest, false when empty
+    bool pull(float* dest) {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        if (size1 == 0) {
+            return false;
+        }
+        std::copy(frames.data() + start1 * numBands, frames.data() + (start1 + 1) * numBands, dest);
+        fifo.finishedRead(1);
+        return true;
+    }
+
+    // spacing of the frames in input samples, set by the processor from the
+    // sample rate and read by the engines
+    void setFrameInterval(int samples) { frameInterval.store(juce::jmax(1, samples)); }
+    int getFrameInterval() const { return frameInterval.load(); }
+
+    // sample rate and fft size of the frames last pushed, for the axis labels
+    void setFormat(double sampleRate, int fftSize) { formatRate.store(sampleRate); formatFftSize.store(fftSize); }
+    double getSampleRate() const { return formatRate.load(); }
+    int getFftSize() const { return formatFftSize.load(); }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<float> frames;
+    std::atomic_flag writing = ATOMIC_FLAG_INIT;
+    std::atomic<int> frameInterval { 800 };
+    std::atomic<double> formatRate { 44100.0 };
+    std::atomic<int> formatFftSize { 2048 };
+
+    JUCE_DECLARE_NON_COPYABLE (SpectrumFifo)
+};
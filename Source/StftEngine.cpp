@@ -0,0 +1,545 @@
+/*
+  ==============================================================================
+
+    StftEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "StftEngine.h"
+#include "SpectralExamples.h"
+#include "ConvolutionProcessor.h"
+
+//==============================================================================
+const char* getFrameSchedulingName(FrameScheduling scheduling) {
+    switch (scheduling) {
+        case FrameScheduling::immediate: return "Immediate";
+        case FrameScheduling::spread:    return "Spread Over Hop";
+        case FrameScheduling::worker:    return "Worker Thread";
+    }
+    return "";
+}
+
+//==============================================================================
+template <typename Processor>
+class SpectralStftEngine<Processor>::Worker : public juce::Thread
+{
+public:
+    explicit Worker(SpectralStftEngine& e)
+        : juce::Thread("stft worker"), engine(e)
+    {
+    }
+
+    void run() override {
+        // never woken by the audio thread, that would mean taking a lock
+        // there. polling every millisecond is well within the queue latency.
+        while (! threadShouldExit()) {
+            while (engine.processWorkerHop()) {
+            }
+            wait(1);
+        }
+    }
+
+private:
+    SpectralStftEngine& engine;
+};
+
+//==============================================================================
+static std::unique_ptr<StftEngine> createSpectralStftEngine(const StftConfig& config) {
+    switch (config.processor) {
+        case SpectralProcessorType::robotize:
+            return std::make_unique<SpectralStftEngine<RobotizeProcessor>>(config);
+        case SpectralProcessorType::spectralGate:
+            return std::make_unique<SpectralStftEngine<SpectralGateProcessor>>(config);
+        case SpectralProcessorType::convolution:
+            return std::make_unique<SpectralStftEngine<ConvolutionProcessor>>(config);
+        case SpectralProcessorType::passthrough:
+            break;
+    }
+    return std::make_unique<SpectralStftEngine<NullSpectralProcessor>>(config);
+}
+
+std::unique_ptr<StftEngine> createStftEngine(const StftConfig& config) {
+    // the processors dispatch their spectral ops on the audio or worker
+    // thread, look the instruction set up here, where reading the cpu
+    // features may allocate
+    spectralops::getKernels();
+    auto engine = createSpectralStftEngine(config);
+    if (! engine->isPrepared()) {
+        return nullptr;
+    }
+    return engine;
+}
+
+//==============================================================================
+template <typename Processor>
+SpectralStftEngine<Processor>::SpectralStftEngine(const StftConfig& c)
+    : StftEngine(c)
+{
+    inBuffer.setSize(config.numChannels, config.getRingSize());
+    outBuffer.setSize(config.numChannels, config.getRingSize());
+    jassert(inBuffer.getCapacity() == outBuffer.getCapacity());
+
+    if (config.scheduling == FrameScheduling::worker) {
+        // room for the hops in flight plus some slack, abstract fifos keep
+        // one slot free
+        numSlots = 2 * config.workerLatencyHops + 3;
+        inputQueue.setTotalSize(numSlots);
+        outputQueue.setTotalSize(numSlots);
+    }
+
+    // a counting pass to size the arena, then the real one
+    layOutBuffers();
+    arena.allocate(arena.getNumBytesUsed());
+    layOutBuffers();
+
+    // the windows are immutable, every engine with this window, size and
+    // hop in the process shares one pair
+    windows = getSharedWindowPair(config.window, config.fftSize, config.hopSize);
+    analysisWindow = windows->analysis.get();
+    synthesisWindow = windows->synthesis.get();
+
+    // log spaced bands from bin 1 to nyquist. the low ones are narrower than
+    // a bin, they repeat the bin they fall in.
+    const int numBins = config.fftSize / 2 + 1;
+    for (int b=0; b<=SpectrumFifo::numBands; b++) {
+        const double bin = std::pow((double) (numBins - 1), (double) b / SpectrumFifo::numBands);
+        bandEdges[b] = juce::jlimit(1, numBins, (int) bin);
+    }
+    // a windowed sine of amplitude 1 peaks at half the window sum
+    double windowSum = 0.0;
+    for (int i=0; i<config.fftSize; i++) {
+        windowSum += analysisWindow[i];
+    }
+    fullScalePower = (float) (windowSum * windowSum / 4.0);
+
+    // pick the backend (benchmarked once per size when automatic) and plan
+    // the transforms once, processFft only executes them
+    fftBackend = createFftBackend(config.backendType, config.fftSize, config.numChannels, config.isPackingStereoPairs());
+    if (! fftBackend->isPrepared()) {
+        // no transform to run, createStftEngine hands out no engine
+        return;
+    }
+    prepared = true;
+    processor.prepare(config.fftSize, config.hopSize, config.numChannels);
+    processor.configure(config, *fftBackend);
+
+    if (config.scheduling == FrameScheduling::worker) {
+        worker = std::make_unique<Worker>(*this);
+    }
+
+    reset();
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::layOutBuffers() {
+    arena.rewind();
+    const size_t frameSamples = (size_t) (config.numChannels * config.fftSize);
+    const size_t hopSamples = (size_t) (config.numChannels * config.hopSize);
+
+    frames = arena.take<float>(frameSamples);
+    bandEdges = arena.take<int>((size_t) SpectrumFifo::numBands + 1);
+    float* spectrumData = arena.take<float>((size_t) SpectralFrame::getNumFloats(config.fftSize, config.numChannels));
+    if (spectrumData != nullptr) {
+        spectrum.setSize(config.fftSize, config.numChannels, spectrumData);
+    }
+
+    // worker queues, empty unless numSlots was set
+    inputSlots = arena.take<float>((size_t) numSlots * hopSamples);
+    outputSlots = arena.take<float>((size_t) numSlots * hopSamples);
+    inputSlotHops = arena.take<juce::int64>((size_t) numSlots);
+    outputSlotHops = arena.take<juce::int64>((size_t) numSlots);
+    queuedInHop = arena.take<float>(numSlots > 0 ? hopSamples : 0);
+    queuedOutHop = arena.take<float>(numSlots > 0 ? hopSamples : 0);
+}
+
+template <typename Processor>
+SpectralStftEngine<Processor>::~SpectralStftEngine()
+{
+    if (worker != nullptr) {
+        worker->stopThread(2000);
+    }
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::reset() {
+    if (worker != nullptr) {
+        worker->stopThread(2000);
+    }
+
+    inWritePointer = 0;
+    hopCounter = 0;
+    frameTime = 0;
+    frameBytesMoved = 0;
+    nextSpectrumTime = 0;
+    nextStage = 0;
+    frameInFlight = false;
+    inBuffer.clear();
+
+    outReadPointer = 0;
+    outBuffer.clear();
+    processor.reset();
+
+    if (worker != nullptr) {
+        inputQueue.reset();
+        outputQueue.reset();
+        const int hopSamples = config.numChannels * config.hopSize;
+        juce::FloatVectorOperations::clear(queuedInHop, hopSamples);
+        juce::FloatVectorOperations::clear(queuedOutHop, hopSamples);
+        // the first boundary comes after hopSize - 1 samples were played
+        queuedOutPosition = 1;
+        numHopsQueued = 0;
+        numUnderruns.store(0);
+        worker->startThread(juce::Thread::Priority::high);
+    }
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::process(float* const* channelData, int numChannels, int numSamples) {
+    numChannels = juce::jmin(numChannels, config.numChannels);
+
+    if (worker != nullptr) {
+        processQueued(channelData, numChannels, numSamples);
+        return;
+    }
+
+    // split the block at hop boundaries and move every chunk in one go
+    for (int start=0; start<numSamples; ) {
+        const int chunk = juce::jmin(config.hopSize - hopCounter, numSamples - start);
+        writeInput(channelData, numChannels, start, chunk);
+        hopCounter += chunk;
+
+        if (config.scheduling == FrameScheduling::spread) {
+            // run the stages that are due by now, evenly spaced over the hop
+            const int numStages = getNumStages();
+            while (frameInFlight && nextStage < numStages
+                   && hopCounter >= (nextStage + 1) * config.hopSize / numStages) {
+                runStage(nextStage);
+                nextStage++;
+            }
+        }
+
+        if (hopCounter < config.hopSize) {
+            readOutput(channelData, numChannels, start, chunk);
+        } else {
+            // the sample that completes the hop is the first one the new
+            // frame is added to, it is read after the frame work
+            hopCounter = 0;
+            readOutput(channelData, numChannels, start, chunk - 1);
+
+            if (config.scheduling == FrameScheduling::spread) {
+                // the frame in flight is complete at the boundary, add it
+                // and take the next snapshot
+                if (frameInFlight) {
+                    overlapAddFrame();
+                }
+                unwrapFrame();
+                frameInFlight = true;
+                nextStage = 0;
+            } else {
+                processFft();
+            }
+
+            readOutput(channelData, numChannels, start + chunk - 1, 1);
+        }
+        start += chunk;
+    }
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::writeInput(const float* const* channelData, int numChannels, int start, int num) {
+    // channels the host didn't pass are fed silence
+    for (int ch=0; ch<config.numChannels; ch++) {
+        if (ch < numChannels) {
+            inBuffer.write(ch, inWritePointer, channelData[ch] + start, num);
+        } else {
+            juce::FloatVectorOperations::clear(inBuffer.getWritePointer(ch, inWritePointer), num);
+            inBuffer.finishedWrite(ch, inWritePointer, num);
+        }
+    }
+    inWritePointer = (inWritePointer + num) % inBuffer.getCapacity();
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::readOutput(float* const* channelData, int numChannels, int start, int num) {
+    if (num <= 0) {
+        return;
+    }
+    // copy out, then clear the samples for the frames still to be added there
+    for (int ch=0; ch<config.numChannels; ch++) {
+        float* ring = outBuffer.getWritePointer(ch, outReadPointer);
+        if (ch < numChannels) {
+            std::memcpy(channelData[ch] + start, ring, sizeof(float) * (size_t) num);
+        }
+        juce::FloatVectorOperations::clear(ring, num);
+        outBuffer.finishedWrite(ch, outReadPointer, num);
+    }
+    outReadPointer = (outReadPointer + num) % outBuffer.getCapacity();
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::processFft() {
+    unwrapFrame();
+    // all channels go through one batched transform
+    computeFft(config.fftSize, 0, config.numChannels);
+    processSpectrum();
+    computeIfft(config.fftSize, 0, config.numChannels);
+    overlapAddFrame();
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::unwrapFrame() {
+    ScopedStageTimer timer(stageTimes, DspStage::unwrap);
+    const int fftSize = config.fftSize;
+    const int ringSize = inBuffer.getCapacity();
+
+    // the frame is the fftSize samples up to the write pointer, one
+    // contiguous run in the mirrored ring. apply the analysis window on the
+    // way into the transform input.
+    const int frameStart = (inWritePointer - fftSize + ringSize) % ringSize;
+    frameTime += config.hopSize;
+    for (int ch=0; ch<config.numChannels; ch++) {
+        juce::FloatVectorOperations::multiply(frames + ch * fftSize, inBuffer.getReadPointer(ch, frameStart),
+                                              analysisWindow, fftSize);
+    }
+    frameBytesMoved += (juce::int64) sizeof(float) * fftSize * config.numChannels;
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::processSpectrum() {
+    ScopedStageTimer timer(stageTimes, DspStage::spectral);
+    for (int ch=0; ch<config.numChannels; ch++) {
+        processor.processChannel(spectrum.getChannel(ch), ch, frameTime);
+    }
+    if (auto* fifo = spectrumFifo.load(std::memory_order_relaxed)) {
+        if (frameTime >= nextSpectrumTime) {
+            nextSpectrumTime = frameTime + fifo->getFrameInterval();
+            pushSpectrum(*fifo);
+        }
+    }
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::pushSpectrum(SpectrumFifo& fifo) {
+    const float scale = 1.0f / (fullScalePower * (float) config.numChannels);
+    fifo.push([this, scale] (float* levels) {
+        for (int b=0; b<SpectrumFifo::numBands; b++) {
+            const int first = bandEdges[b];
+            const int last = juce::jmax(first + 1, bandEdges[b + 1]);
+            // peak of the channel mean over the band
+            float peak = 0.0f;
+            for (int k=first; k<last; k++) {
+                float power = 0.0f;
+                for (int ch=0; ch<config.numChannels; ch++) {
+                    const float re = spectrum.getReal(ch)[k];
+                    const float im = spectrum.getImag(ch)[k];
+                    power += re * re + im * im;
+                }
+                peak = juce::jmax(peak, power);
+            }
+            levels[b] = juce::jmax(SpectrumFifo::floorDb, 10.0f * std::log10(peak * scale + 1.0e-30f));
+        }
+    });
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::overlapAddFrame() {
+    ScopedStageTimer timer(stageTimes, DspStage::writeBack);
+    const int fftSize = config.fftSize;
+
+    // weighted overlap-add of the inverse transforms into outBuffers,
+    // starting at the next sample to be read. the synthesis window also does
+    // the 1/fftSize scaling.
+    for (int ch=0; ch<config.numChannels; ch++) {
+        juce::FloatVectorOperations::addWithMultiply(outBuffer.getWritePointer(ch, outReadPointer), frames + ch * fftSize,
+                                                     synthesisWindow, fftSize);
+        outBuffer.finishedWrite(ch, outReadPointer, fftSize);
+    }
+
+    // the frame is complete, publish what it moved
+    frameBytesMoved += (juce::int64) sizeof(float) * fftSize * config.numChannels;
+    frameBytesMoved += fftBackend->takeBytesCopied();
+    bytesMovedPerHop.store((int) frameBytesMoved);
+    frameBytesMoved = 0;
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::runStage(int stage) {
+    const int numTransformStages = getNumTransformStages();
+    const int channelsPerStage = config.numChannels / numTransformStages;
+
+    if (stage < numTransformStages) {
+        computeFft(config.fftSize, stage * channelsPerStage, channelsPerStage);
+    } else if (stage == numTransformStages) {
+        processSpectrum();
+    } else {
+        const int transform = stage - numTransformStages - 1;
+        computeIfft(config.fftSize, transform * channelsPerStage, channelsPerStage);
+    }
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::processQueued(float* const* channelData, int numChannels, int numSamples) {
+    const int hopSize = config.hopSize;
+
+    // same chunking as process(), the rings are replaced by the hop being
+    // collected and the hop being played
+    for (int start=0; start<numSamples; ) {
+        const int chunk = juce::jmin(hopSize - hopCounter, numSamples - start);
+        for (int ch=0; ch<config.numChannels; ch++) {
+            float* dest = queuedInHop + ch * hopSize + hopCounter;
+            if (ch < numChannels) {
+                std::memcpy(dest, channelData[ch] + start, sizeof(float) * (size_t) chunk);
+            } else {
+                juce::FloatVectorOperations::clear(dest, chunk);
+            }
+        }
+        hopCounter += chunk;
+
+        if (hopCounter < hopSize) {
+            readQueuedOutput(channelData, numChannels, start, chunk);
+        } else {
+            hopCounter = 0;
+            readQueuedOutput(channelData, numChannels, start, chunk - 1);
+            exchangeQueuedHops();
+            readQueuedOutput(channelData, numChannels, start + chunk - 1, 1);
+        }
+        start += chunk;
+    }
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::readQueuedOutput(float* const* channelData, int numChannels, int start, int num) {
+    if (num <= 0) {
+        return;
+    }
+    for (int ch=0; ch<numChannels; ch++) {
+        std::memcpy(channelData[ch] + start, queuedOutHop + ch * config.hopSize + queuedOutPosition, sizeof(float) * (size_t) num);
+    }
+    queuedOutPosition += num;
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::exchangeQueuedHops() {
+    const int hopSamples = config.numChannels * config.hopSize;
+
+    // hand the hop to the worker, or drop it if the worker is that far behind
+    int start1, size1, start2, size2;
+    inputQueue.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 > 0) {
+        std::memcpy(inputSlots + start1 * hopSamples, queuedInHop, sizeof(float) * (size_t) hopSamples);
+        inputSlotHops[start1] = numHopsQueued;
+        inputQueue.finishedWrite(1);
+    } else {
+        numUnderruns++;
+    }
+
+    // the output hop due now belongs to the input hop queued
+    // workerLatencyHops hops ago. late hops are skipped so the latency stays
+    // fixed, a missing one is played as silence.
+    const juce::int64 wantedHop = numHopsQueued - config.workerLatencyHops;
+    numHopsQueued++;
+    bool found = false;
+    while (wantedHop >= 0 && ! found && outputQueue.getNumReady() > 0) {
+        outputQueue.prepareToRead(1, start1, size1, start2, size2);
+        const juce::int64 hop = outputSlotHops[start1];
+        if (hop == wantedHop) {
+            std::memcpy(queuedOutHop, outputSlots + start1 * hopSamples, sizeof(float) * (size_t) hopSamples);
+            found = true;
+        }
+        if (hop > wantedHop) {
+            break;
+        }
+        outputQueue.finishedRead(1);
+    }
+    if (! found) {
+        juce::FloatVectorOperations::clear(queuedOutHop, hopSamples);
+        if (wantedHop >= 0) {
+            numUnderruns++;
+        }
+    }
+    queuedOutPosition = 0;
+}
+
+template <typename Processor>
+bool SpectralStftEngine<Processor>::processWorkerHop() {
+    int start1, size1, start2, size2;
+    inputQueue.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 == 0) {
+        return false;
+    }
+
+    const int hopSize = config.hopSize;
+    const int ringSize = inBuffer.getCapacity();
+    const int hopSamples = config.numChannels * hopSize;
+    const float* hop = inputSlots + start1 * hopSamples;
+    const juce::int64 hopIndex = inputSlotHops[start1];
+
+    // same as hopSize samples of the immediate scheduling, in one go
+    for (int ch=0; ch<config.numChannels; ch++) {
+        inBuffer.write(ch, inWritePointer, hop + ch * hopSize, hopSize);
+    }
+    inWritePointer = (inWritePointer + hopSize) % ringSize;
+    inputQueue.finishedRead(1);
+
+    // the hop is copied four times on its way: into an input slot and into
+    // the ring here, then out of the ring into an output slot and out of
+    // that on the audio thread
+    frameBytesMoved += (juce::int64) sizeof(float) * 4 * hopSamples;
+
+    processFft();
+
+    // the next hopSize output samples are complete now. if the audio thread
+    // hasn't collected enough the hop is lost, it would be too late anyway.
+    outputQueue.prepareToWrite(1, start1, size1, start2, size2);
+    float* slot = size1 > 0 ? outputSlots + start1 * hopSamples : nullptr;
+    for (int ch=0; ch<config.numChannels; ch++) {
+        float* ring = outBuffer.getWritePointer(ch, outReadPointer);
+        if (slot != nullptr) {
+            std::memcpy(slot + ch * hopSize, ring, sizeof(float) * (size_t) hopSize);
+        }
+        juce::FloatVectorOperations::clear(ring, hopSize);
+        outBuffer.finishedWrite(ch, outReadPointer, hopSize);
+    }
+    outReadPointer = (outReadPointer + hopSize) % ringSize;
+    if (slot != nullptr) {
+        outputSlotHops[start1] = hopIndex;
+        outputQueue.finishedWrite(1);
+    }
+    return true;
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::computeFft(int bufferSize, int firstChannel, int numChannels) {
+    ScopedStageTimer timer(stageTimes, DspStage::forwardFft);
+    jassert(bufferSize == fftBackend->getSize());
+    if (config.isPackingStereoPairs() && numChannels == 2) {
+        fftBackend->forwardPair(frames + firstChannel * bufferSize,
+                                spectrum.getReal(firstChannel), spectrum.getImag(firstChannel),
+                                spectrum.getChannelStride());
+        return;
+    }
+    fftBackend->forwardSplit(frames + firstChannel * bufferSize,
+                             spectrum.getReal(firstChannel), spectrum.getImag(firstChannel),
+                             numChannels, spectrum.getChannelStride());
+}
+
+template <typename Processor>
+void SpectralStftEngine<Processor>::computeIfft(int bufferSize, int firstChannel, int numChannels) {
+    ScopedStageTimer timer(stageTimes, DspStage::inverseFft);
+    jassert(bufferSize == fftBackend->getSize());
+    if (config.isPackingStereoPairs() && numChannels == 2) {
+        fftBackend->inversePair(spectrum.getReal(firstChannel), spectrum.getImag(firstChannel),
+                                frames + firstChannel * bufferSize, spectrum.getChannelStride());
+        return;
+    }
+    fftBackend->inverseSplit(spectrum.getReal(firstChannel), spectrum.getImag(firstChannel),
+                             frames + firstChannel * bufferSize,
+                             numChannels, spectrum.getChannelStride());
+}
+
+//==============================================================================
+template class SpectralStftEngine<NullSpectralProcessor>;
+template class SpectralStftEngine<RobotizeProcessor>;
+template class SpectralStftEngine<SpectralGateProcessor>;
+template class SpectralStftEngine<ConvolutionProcessor>;
@@ -0,0 +1,277 @@
+/*
+  ==============================================================================
+
+    StftEngine.h
+
+    The complete stft state for one configuration (fft size, hop size and
+    number of channels): circular input/output buffers, frame buffers and the
+    fft backend. An engine is fully allocated and planned by its constructor,
+    so a new one can be built on a background thread while the old one keeps
+    running, and then handed to the audio thread as a ready object.
+
+    The engine is a template on its spectral processor, StftEngine is the
+    interface the plugin holds it through. The only virtual call is
+    process(), once per block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "FftBackend.h"
+#include "StftWindow.h"
+#include "SpectralProcessor.h"
+#include "SpectralFrame.h"
+#include "MirroredRingBuffer.h"
+#include "AlignedArena.h"
+#include "DspTelemetry.h"
+#include "SpectrumFifo.h"
+#include "ConvolutionProcessor.h"
+
+//==============================================================================
+enum class FrameScheduling
+{
+    // the whole frame is processed in the sample its last hop sample arrives
+    immediate,
+    // the frame is snapshot at the hop boundary and its transforms are spread
+    // evenly over the next hop, one stage at a time. costs one hop of latency.
+    spread,
+    // the audio thread only queues input hops and collects output hops, the
+    // frames are processed on a worker thread. costs workerLatencyHops hops.
+    worker
+};
+
+const char* getFrameSchedulingName(FrameScheduling scheduling);
+
+//==============================================================================
+struct StftConfig
+{
+    int fftSize = 2048;
+    int hopSize = 128;
+    int numChannels = 2;
+    FftBackendType backendType = FftBackendType::automatic;
+    WindowType window = WindowType::sqrtHann;
+    SpectralProcessorType processor = SpectralProcessorType::passthrough;
+    FrameScheduling scheduling = FrameScheduling::immediate;
+    // how many hops an output hop may take to come back from the worker,
+    // it should cover at least one host block plus one hop
+    int workerLatencyHops = 2;
+    // with two channels, transform both with one complex fft per hop instead
+    // of two real ones, see FftBackend::forwardPair. ignored otherwise.
+    bool packStereoPairs = false;
+    // the filter of the convolution processor, nullptr for none (the
+    // convolution then passes the input through). it has to be at the
+    // engine's sample rate, and the engine needs the overlapSave window and
+    // a hop of at most fftSize/2, the length of its partitions.
+    std::shared_ptr<const ImpulseResponse> impulseResponse;
+
+    bool isPackingStereoPairs() const { return packStereoPairs && numChannels == 2; }
+
+    // the circular buffers hold at least one frame, the mirrored rings may
+    // round that up to whole memory pages
+    int getRingSize() const { return fftSize; }
+
+    // a frame is transformed as soon as its newest sample arrives and is
+    // added back starting at the very next output sample, so every sample
+    // comes out fftSize - 1 samples later, whatever the hop or window.
+    // spreading the work over the following hop delays that by one hop,
+    // handing it to the worker thread by workerLatencyHops hops.
+    int getLatencySamples() const {
+        switch (scheduling) {
+            case FrameScheduling::spread: return fftSize - 1 + hopSize;
+            case FrameScheduling::worker: return fftSize - 1 + workerLatencyHops * hopSize;
+            case FrameScheduling::immediate: break;
+        }
+        return fftSize - 1;
+    }
+    // output can go on for the latency plus one frame after the input stops,
+    // since spectral processing can spread a sample over its whole frame,
+    // and a convolution for the length of its impulse response on top
+    int getTailSamples() const {
+        const bool convolving = processor == SpectralProcessorType::convolution && impulseResponse != nullptr;
+        return getLatencySamples() + fftSize - 1 + (convolving ? impulseResponse->getNumSamples() : 0);
+    }
+
+    bool operator==(const StftConfig& other) const {
+        return fftSize == other.fftSize && hopSize == other.hopSize
+            && numChannels == other.numChannels && backendType == other.backendType
+            && window == other.window && processor == other.processor
+            && scheduling == other.scheduling && isPackingStereoPairs() == other.isPackingStereoPairs()
+            && (scheduling != FrameScheduling::worker || workerLatencyHops == other.workerLatencyHops)
+            && (processor != SpectralProcessorType::convolution || impulseResponse == other.impulseResponse);
+    }
+    bool operator!=(const StftConfig& other) const { return ! operator==(other); }
+};
+
+//==============================================================================
+class StftEngine
+{
+public:
+    virtual ~StftEngine() = default;
+
+    const StftConfig& getConfig() const { return config; }
+
+    // false when the transforms couldn't be set up, the engine must not run
+    bool isPrepared() const { return prepared; }
+
+    // clears all buffers and pointers back to their initial state. with the
+    // worker scheduling this also stops and restarts the worker thread.
+    virtual void reset() = 0;
+
+    // runs numSamples samples of numChannels channels through the stft, in
+    // place. blocks of any length, including zero, are split at hop boundaries.
+    virtual void process(float* const* channelData, int numChannels, int numSamples) = 0;
+
+    // number of output hops the worker didn't deliver in time (played as
+    // silence) or input hops it couldn't take, since the last call. audio thread.
+    int takeNumUnderruns() { return numUnderruns.exchange(0); }
+
+    // bytes written by the data movement of the last frame: unwrapping into
+    // the transform input, any copies the fft backend makes into its own
+    // buffers, the overlap-add and, with the worker scheduling, the hops
+    // handed over through the queues. any thread.
+    int getBytesMovedPerHop() const { return bytesMovedPerHop.load(); }
+
+    // cycles spent in each frame stage, added by whichever thread runs the
+    // frames and taken by the audio thread, see DspTelemetry
+    StageTimes& getStageTimes() { return stageTimes; }
+
+    // where to send decimated magnitude frames for the analyzer, nullptr for
+    // nowhere. may be changed while frames are being processed.
+    void setSpectrumFifo(SpectrumFifo* fifo) { spectrumFifo.store(fifo); }
+
+protected:
+    explicit StftEngine(const StftConfig& c) : config(c) {}
+
+    const StftConfig config;
+    bool prepared = false;
+    std::atomic<int> numUnderruns { 0 };
+    std::atomic<int> bytesMovedPerHop { 0 };
+    StageTimes stageTimes;
+    std::atomic<SpectrumFifo*> spectrumFifo { nullptr };
+};
+
+// builds the engine for config.processor: allocates all buffers and plans the
+// transforms. nullptr if no fft backend could be prepared. not real-time safe.
+std::unique_ptr<StftEngine> createStftEngine(const StftConfig& config);
+
+//==============================================================================
+template <typename Processor>
+class SpectralStftEngine final : public StftEngine
+{
+public:
+    explicit SpectralStftEngine(const StftConfig& config);
+    ~SpectralStftEngine() override;
+
+    void reset() override;
+    void process(float* const* channelData, int numChannels, int numSamples) override;
+
+    void processFft();
+
+    // transforms the frames of numChannels channels from firstChannel on at
+    // once, frames -> spectrum and spectrum -> frames
+    void computeFft(int bufferSize, int firstChannel, int numChannels);
+    void computeIfft(int bufferSize, int firstChannel, int numChannels);
+
+private:
+    // the stages processFft is made of, also run one by one when spread
+    void unwrapFrame();
+    void processSpectrum();
+    void overlapAddFrame();
+    // analyzer: reduces the spectrum to SpectrumFifo::numBands levels
+    void pushSpectrum(SpectrumFifo& fifo);
+
+    // spread scheduling: the forward transforms come first, one per channel
+    // or one for a packed pair, then the spectral stage, then the inverse
+    // transforms
+    int getNumTransformStages() const { return config.isPackingStereoPairs() ? 1 : config.numChannels; }
+    int getNumStages() const { return 2 * getNumTransformStages() + 1; }
+    void runStage(int stage);
+
+    // move num samples from/to the host buffers, starting at sample start,
+    // into the input ring and out of the output ring
+    void writeInput(const float* const* channelData, int numChannels, int start, int num);
+    void readOutput(float* const* channelData, int numChannels, int start, int num);
+
+    // worker scheduling: the audio thread side, and one queued hop on the
+    // worker side. processWorkerHop returns false when the queue was empty.
+    void processQueued(float* const* channelData, int numChannels, int numSamples);
+    void readQueuedOutput(float* const* channelData, int numChannels, int start, int num);
+    // at a hop boundary: queue the collected hop, take the output hop due
+    void exchangeQueuedHops();
+    bool processWorkerHop();
+
+    Processor processor;
+    // input samples received when the current frame was taken
+    juce::int64 frameTime;
+
+    std::unique_ptr<FftBackend> fftBackend;
+
+    // circular input buffer, one per channel. all channels move in lockstep,
+    // so the pointers and the hop counter are shared. the ring is mirrored,
+    // so the newest frame is one contiguous run ending at the write pointer.
+    MirroredRingBuffer inBuffer;
+    int inWritePointer;
+    int hopCounter;
+
+    // spread scheduling: next stage to run for the frame in flight
+    int nextStage;
+    bool frameInFlight;
+
+    // circular overlap-add buffer, one per channel. every frame is added in
+    // starting at the read pointer, in one run thanks to the mirroring, and
+    // samples are cleared once read.
+    MirroredRingBuffer outBuffer;
+    int outReadPointer;
+
+    // analysis window, and synthesis window with the ifft and cola gain
+    // folded in, from the pair shared through FftResourceRegistry
+    std::shared_ptr<const StftWindowPair> windows;
+    const float* analysisWindow = nullptr;
+    const float* synthesisWindow = nullptr;
+
+    // every buffer below is carved out of this one block, sized and
+    // allocated by the constructor, see layOutBuffers
+    AlignedArena arena;
+    void layOutBuffers();
+
+    // time domain frames of all channels, one after the other. the input
+    // ring is unwrapped straight into them, the forward transform reads them
+    // and the inverse writes back into them, from where they are added to
+    // the output ring. both buffers are aligned and laid out the way the
+    // backends plan for, so fftw runs on them without copies of its own.
+    float* frames = nullptr;
+    // the half spectrum of every channel as split real/imag arrays, the
+    // spectral processor works on it in place
+    SpectralFrame spectrum;
+    // analyzer: first bin of every band plus the end of the last one, the
+    // power of a full scale sine, and when the next frame is due
+    int* bandEdges = nullptr;
+    float fullScalePower = 1.0f;
+    juce::int64 nextSpectrumTime = 0;
+    // bytes moved for the frame in flight so far, see getBytesMovedPerHop
+    juce::int64 frameBytesMoved;
+
+    // worker scheduling. hops of all channels are passed as numChannels *
+    // hopSize samples, tagged with the index of the input hop they belong to.
+    // the audio thread is the only writer of inputQueue and the only reader of
+    // outputQueue, the worker thread the other way round.
+    class Worker;
+    std::unique_ptr<Worker> worker;
+    juce::AbstractFifo inputQueue { 1 };
+    juce::AbstractFifo outputQueue { 1 };
+    int numSlots = 0;
+    float* inputSlots = nullptr;
+    float* outputSlots = nullptr;
+    juce::int64* inputSlotHops = nullptr;
+    juce::int64* outputSlotHops = nullptr;
+    // audio thread: the hop being collected and the hop being played
+    float* queuedInHop = nullptr;
+    float* queuedOutHop = nullptr;
+    int queuedOutPosition;
+    juce::int64 numHopsQueued;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralStftEngine)
+};
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    StftWindow.cpp
+
+  ==============================================================================
+*/
+
+#include "StftWindow.h"
+#include "FftResourceRegistry.h"
+
+//==============================================================================
+const char* getWindowName(WindowType type) {
+    switch (type) {
+        case WindowType::hann:           return "Hann";
+        case WindowType::sqrtHann:       return "Sqrt Hann";
+        case WindowType::blackmanHarris: return "Blackman-Harris";
+        case WindowType::overlapSave:    return "Overlap-Save";
+    }
+    return "";
+}
+
+int getMaxHopSize(WindowType type, int size) {
+    // analysis * synthesis is the window squared, a cosine sum of terms up
+    // to 2, 1 (sqrt hann) or 6 times the frame rate, which sums to a
+    // constant once the hop rate is above the highest one
+    switch (type) {
+        case WindowType::hann:           return size / 4;
+        case WindowType::sqrtHann:       return size / 2;
+        case WindowType::blackmanHarris: return size / 8;
+        case WindowType::overlapSave:    return size / 2;
+    }
+    return size / 2;
+}
+
+// periodic windows (period = size), they overlap-add to a constant at hops
+// that divide the size
+static double windowValue(WindowType type, int n, int size) {
+    const double x = juce::MathConstants<double>::twoPi * n / size;
+    switch (type) {
+        case WindowType::hann:
+            return 0.5 - 0.5 * std::cos(x);
+        case WindowType::sqrtHann:
+            return std::sqrt(0.5 - 0.5 * std::cos(x));
+        case WindowType::blackmanHarris:
+            return 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2.0 * x) - 0.01168 * std::cos(3.0 * x);
+        case WindowType::overlapSave:
+            break;
+    }
+    return 1.0;
+}
+
+void createWindowPair(WindowType type, int size, int hopSize, float* analysis, float* synthesis) {
+    if (type == WindowType::overlapSave) {
+        // the frame goes in unwindowed and only its newest hop comes out,
+        // the part the circular convolution of a multiply by a filter of at
+        // most size - hopSize + 1 taps leaves uncorrupted. every output
+        // sample is written by exactly one frame.
+        for (int n=0; n<size; n++) {
+            analysis[n] = 1.0f;
+            synthesis[n] = n >= size - hopSize ? 1.0f / size : 0.0f;
+        }
+        return;
+    }
+
+    // overlapping frames add up to sum(analysis * synthesis) / hopSize on
+    // average, normalise that to one
+    double productSum = 0.0;
+    for (int n=0; n<size; n++) {
+        const double w = windowValue(type, n, size);
+        analysis[n] = (float) w;
+        productSum += w * w;
+    }
+
+    const double gain = hopSize / (productSum * size);
+    for (int n=0; n<size; n++) {
+        synthesis[n] = (float) (analysis[n] * gain);
+    }
+}
+
+//==============================================================================
+StftWindowPair::StftWindowPair(WindowType type, int size, int hopSize)
+    : analysis((size_t) size), synthesis((size_t) size)
+{
+    createWindowPair(type, size, hopSize, analysis.get(), synthesis.get());
+}
+
+std::shared_ptr<const StftWindowPair> getSharedWindowPair(WindowType type, int size, int hopSize) {
+    FftResourceKey key;
+    key.kind = FftResourceKind::windowPair;
+    key.fftSize = size;
+    key.window = type;
+    key.hopSize = hopSize;
+    return FftResourceRegistry::getInstance().getOrCreate<StftWindowPair>(key, [=] {
+        return std::make_shared<StftWindowPair>(type, size, hopSize);
+    });
+}
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    StftWindow.h
+
+    Analysis/synthesis window pairs for the weighted overlap-add stage.
+    Hann and sqrt hann reconstruct perfectly from a hop of fftSize/4 and
+    fftSize/2 down, blackman-harris needs a hop of fftSize/8 or less.
+    Overlap-save is not a window for spectral processing but turns the
+    overlap-add into fast convolution, see ConvolutionProcessor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include "AlignedBuffer.h"
+
+//==============================================================================
+enum class WindowType
+{
+    hann,            // hann analysis and synthesis
+    sqrtHann,        // square root hann analysis and synthesis (hann overall)
+    blackmanHarris,  // 4 term blackman-harris analysis and synthesis
+    overlapSave      // rectangular analysis, synthesis keeps the newest hop
+};
+
+const char* getWindowName(WindowType type);
+
+// the largest hop at which a pair of this type overlap-adds to a constant,
+// for a power of two size: size/4 for hann, size/2 for sqrt hann and
+// overlap-save, size/8 for blackman-harris. larger hops modulate the output.
+int getMaxHopSize(WindowType type, int size);
+
+// fills the analysis and synthesis windows for a frame of size samples. the
+// synthesis window also carries the 1/size ifft scaling and the gain that
+// makes the overlap-add of analysis * synthesis at the given hop sum to one.
+void createWindowPair(WindowType type, int size, int hopSize, float* analysis, float* synthesis);
+
+// an immutable window pair as made by createWindowPair, shared by every
+// engine with the same window, size and hop (see FftResourceRegistry)
+struct StftWindowPair
+{
+    StftWindowPair(WindowType type, int size, int hopSize);
+
+    size_t getNumBytes() const { return sizeof(float) * (analysis.getSize() + synthesis.getSize()); }
+
+    AlignedBuffer<float> analysis, synthesis;
+};
+
+// looks the pair up in the registry, building it on first use. takes a
+// lock, not real-time safe.
+std::shared_ptr<const StftWindowPair> getSharedWindowPair(WindowType type, int size, int hopSize);
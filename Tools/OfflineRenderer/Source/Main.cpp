@@ -0,0 +1,299 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless offline renderer: runs audio files through
+    FftPassthroughAudioProcessor without a host or gui, faster than real
+    time. Files are spread over a pool of render threads, each with its own
+    processor, read and written in large blocks with juce_audio_formats. The
+    processor's latency is trimmed off, so every output lines up with its
+    input and has the same length.
+
+    usage: OfflineRenderer [options] <file>...
+      --output-dir=<dir>   where the results go (default: next to the input,
+                           named <name>_processed.<ext>)
+      --threads=<n>        render threads (default: one per cpu core)
+      --block-size=<n>     samples per processBlock call (default 16384)
+      --fft-size=<n>, --hop-size=<n>
+      --window=<name>, --processor=<name>, --backend=<name>,
+      --stereo-transform=<name>
+                           names as in the plugin, case and spaces ignored
+      --ir=<file>          impulse response for --processor=convolution
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+//==============================================================================
+namespace
+{
+    juce::CriticalSection printLock;
+
+    void print(const juce::String& text) {
+        const juce::ScopedLock lock(printLock);
+        std::cout << text << std::endl;
+    }
+
+    juce::String simplifyName(const juce::String& name) {
+        return name.removeCharacters(" -_").toLowerCase();
+    }
+
+    // processor settings given on the command line, parameter id -> choice
+    // text, plus the fft backend
+    struct RenderSettings
+    {
+        juce::StringPairArray choices;
+        FftBackendType backend = FftBackendType::automatic;
+        int blockSize = 16384;
+        juce::File outputDir;
+        // read once, every processor resamples it to the rate of its file
+        std::shared_ptr<const ImpulseResponse> impulseResponse;
+    };
+
+    // sets every choice parameter named in settings, returns an error message
+    // for a value the parameter doesn't offer
+    juce::String applySettings(FftPassthroughAudioProcessor& processor, const RenderSettings& settings) {
+        for (auto& id : settings.choices.getAllKeys()) {
+            if (! processor.setChoiceParameter(id, settings.choices[id])) {
+                auto* choice = dynamic_cast<juce::AudioParameterChoice*>(processor.parameters.getParameter(id));
+                return "invalid " + choice->name + " \"" + settings.choices[id] + "\", expected one of: "
+                       + choice->choices.joinIntoString(", ");
+            }
+        }
+        processor.setFftBackend(settings.backend);
+        if (settings.impulseResponse != nullptr) {
+            processor.setImpulseResponse(settings.impulseResponse->samples, settings.impulseResponse->sampleRate);
+        }
+        return {};
+    }
+}
+
+//==============================================================================
+// renders one file after the other from a shared list, with one processor
+// that it keeps for all of them
+class RenderJob : public juce::ThreadPoolJob
+{
+public:
+    RenderJob(const juce::Array<juce::File>& f, std::atomic<int>& next, const RenderSettings& s,
+              juce::AudioFormatManager& formats, std::atomic<int>& failures)
+        : juce::ThreadPoolJob("render"), files(f), nextFile(next), settings(s),
+          formatManager(formats), numFailures(failures)
+    {
+        // made here on the message thread, the processor's parameter state
+        // runs a timer
+        processor = std::make_unique<FftPassthroughAudioProcessor>();
+        setupError = applySettings(*processor, settings);
+    }
+
+    // why the settings couldn't be applied, empty if they could
+    const juce::String& getSetupError() const { return setupError; }
+
+    JobStatus runJob() override {
+        for (int i = nextFile++; i < files.size() && ! shouldExit(); i = nextFile++) {
+            const auto message = render(files.getReference(i));
+            if (message.isNotEmpty()) {
+                print(files.getReference(i).getFullPathName() + ": " + message);
+                numFailures++;
+            }
+        }
+        processor->releaseResources();
+        return jobHasFinished;
+    }
+
+private:
+    juce::File getOutputFile(const juce::File& input) const {
+        if (settings.outputDir != juce::File()) {
+            return settings.outputDir.getChildFile(input.getFileName());
+        }
+        return input.getSiblingFile(input.getFileNameWithoutExtension() + "_processed" + input.getFileExtension());
+    }
+
+    // renders input, returns an error message or an empty string
+    juce::String render(const juce::File& input) {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+        if (reader == nullptr) {
+            return "can't be read as audio";
+        }
+        const int numChannels = (int) reader->numChannels;
+        if (numChannels < 1 || numChannels > 2) {
+            return "only mono and stereo files are supported";
+        }
+
+        // the processor runs the file's layout at the file's rate
+        const auto layout = numChannels == 1 ? juce::AudioChannelSet::mono() : juce::AudioChannelSet::stereo();
+        processor->releaseResources();
+        juce::AudioProcessor::BusesLayout buses;
+        buses.inputBuses.add(layout);
+        buses.outputBuses.add(layout);
+        if (! processor->setBusesLayout(buses)) {
+            return "channel layout not supported";
+        }
+        processor->setNonRealtime(true);
+        processor->setRateAndBufferSizeDetails(reader->sampleRate, settings.blockSize);
+        processor->prepareToPlay(reader->sampleRate, settings.blockSize);
+
+        const auto output = getOutputFile(input);
+        auto* format = formatManager.findFormatForFileExtension(output.getFileExtension());
+        if (format == nullptr) {
+            return "no writer for " + output.getFileExtension();
+        }
+        // keep the input's bit depth where the output format has it
+        int bitDepth = (int) reader->bitsPerSample;
+        const auto depths = format->getPossibleBitDepths();
+        if (! depths.contains(bitDepth) && ! depths.isEmpty()) {
+            bitDepth = depths.getLast();
+        }
+
+        output.deleteFile();
+        std::unique_ptr<juce::FileOutputStream> stream(output.createOutputStream());
+        if (stream == nullptr) {
+            return "can't write " + output.getFullPathName();
+        }
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), reader->sampleRate, (unsigned int) numChannels,
+                                                                                bitDepth, reader->metadataValues, 0));
+        if (writer == nullptr) {
+            return "can't create a " + format->getFormatName() + " writer";
+        }
+        // the writer owns the stream now
+        stream.release();
+
+        // run latency samples past the end so the whole input comes out, the
+        // reader fills in silence there, and drop as many from the start
+        const juce::int64 length = reader->lengthInSamples;
+        const juce::int64 latency = processor->getLatencySamples();
+        juce::AudioBuffer<float> buffer(numChannels, settings.blockSize);
+        juce::MidiBuffer midi;
+
+        const auto startTime = juce::Time::getMillisecondCounterHiRes();
+        for (juce::int64 position = 0; position < length + latency && ! shouldExit(); position += settings.blockSize) {
+            const int numSamples = (int) juce::jmin((juce::int64) settings.blockSize, length + latency - position);
+            buffer.setSize(numChannels, numSamples, false, false, true);
+            reader->read(&buffer, 0, numSamples, position, true, true);
+            processor->processBlock(buffer, midi);
+
+            const int skip = (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples, latency - position);
+            if (skip < numSamples && ! writer->writeFromAudioSampleBuffer(buffer, skip, numSamples - skip)) {
+                return "write failed";
+            }
+        }
+        writer.reset();
+        const double seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+        const double duration = (double) length / reader->sampleRate;
+        print(input.getFileName() + ": " + juce::String(duration, 2) + " s of audio in " + juce::String(seconds, 2)
+              + " s, " + juce::String(duration / juce::jmax(seconds, 1.0e-6), 1) + "x real time -> " + output.getFullPathName());
+        return {};
+    }
+
+    const juce::Array<juce::File>& files;
+    std::atomic<int>& nextFile;
+    const RenderSettings& settings;
+    juce::AudioFormatManager& formatManager;
+    std::atomic<int>& numFailures;
+
+    std::unique_ptr<FftPassthroughAudioProcessor> processor;
+    juce::String setupError;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderJob)
+};
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    RenderSettings settings;
+    juce::Array<juce::File> files;
+    int numThreads = juce::SystemStats::getNumCpus();
+
+    const std::pair<const char*, const char*> choiceOptions[] = {
+        { "--fft-size", "fftSize" }, { "--hop-size", "hopSize" }, { "--window", "window" },
+        { "--processor", "processor" }, { "--stereo-transform", "stereoTransform" }
+    };
+    for (auto& option : choiceOptions) {
+        if (args.containsOption(option.first)) {
+            settings.choices.set(option.second, args.getValueForOption(option.first));
+        }
+    }
+    if (args.containsOption("--backend")) {
+        const auto wanted = simplifyName(args.getValueForOption("--backend"));
+        bool found = false;
+        for (auto type : { FftBackendType::automatic, FftBackendType::fftw, FftBackendType::juce, FftBackendType::radix,
+                           FftBackendType::fixedSize }) {
+            if (simplifyName(getFftBackendName(type)) == wanted) {
+                settings.backend = type;
+                found = true;
+            }
+        }
+        if (! found) {
+            print("unknown backend " + args.getValueForOption("--backend"));
+            return 1;
+        }
+    }
+    if (args.containsOption("--ir")) {
+        settings.impulseResponse = readImpulseResponse(args.getFileForOption("--ir"));
+        if (settings.impulseResponse == nullptr) {
+            print("can't read the impulse response " + args.getValueForOption("--ir"));
+            return 1;
+        }
+    }
+    if (args.containsOption("--threads")) {
+        numThreads = juce::jmax(1, args.getValueForOption("--threads").getIntValue());
+    }
+    if (args.containsOption("--block-size")) {
+        settings.blockSize = juce::jmax(1, args.getValueForOption("--block-size").getIntValue());
+    }
+    if (args.containsOption("--output-dir")) {
+        settings.outputDir = args.getFileForOption("--output-dir");
+        if (! settings.outputDir.createDirectory()) {
+            print("can't create " + settings.outputDir.getFullPathName());
+            return 1;
+        }
+    }
+    for (auto& arg : args.arguments) {
+        if (! arg.isOption()) {
+            files.add(arg.resolveAsFile());
+        }
+    }
+    if (files.isEmpty()) {
+        print("usage: OfflineRenderer [--output-dir=<dir>] [--threads=<n>] [--block-size=<n>] [--fft-size=<n>] [--hop-size=<n>]\n"
+              "                       [--window=<name>] [--processor=<name>] [--backend=<name>]\n"
+              "                       [--stereo-transform=<name>] [--ir=<file>] <file>...");
+        return 1;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::atomic<int> nextFile { 0 };
+    std::atomic<int> numFailures { 0 };
+    numThreads = juce::jmin(numThreads, files.size());
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+    {
+        juce::OwnedArray<RenderJob> jobs;
+        for (int i=0; i<numThreads; i++) {
+            jobs.add(new RenderJob(files, nextFile, settings, formatManager, numFailures));
+        }
+        if (jobs.getFirst()->getSetupError().isNotEmpty()) {
+            print(jobs.getFirst()->getSetupError());
+            return 1;
+        }
+
+        juce::ThreadPool pool(numThreads);
+        for (auto* job : jobs) {
+            pool.addJob(job, false);
+        }
+        while (pool.getNumJobs() > 0) {
+            juce::Thread::sleep(10);
+        }
+    }
+    print(juce::String(files.size() - numFailures.load()) + " of " + juce::String(files.size()) + " files rendered in "
+          + juce::String((juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0, 2) + " s on "
+          + juce::String(numThreads) + " threads");
+
+    return numFailures.load() == 0 ? 0 : 1;
+}
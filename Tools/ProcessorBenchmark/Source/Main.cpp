@@ -0,0 +1,939 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Benchmark for FftPassthroughAudioProcessor: drives processBlock directly
+    with synthetic buffers over a sweep of fft sizes, hops, host block sizes
+    and channel counts, and prints one JSON object per configuration with
+    the cost per sample, mean/p99/max callback time and the operator new
+    calls per callback (counted when built with FFT_COUNT_ALLOCATIONS).
+    An instancing run prepares many processors at once, like a session full
+    of plugin instances, and reports the prepare time of the first and the
+    later ones along with the FftResourceRegistry counters. A kernel run
+    times a forward and inverse split transform on every backend, and the
+    fixed size kernels on every instruction set the cpu has, relative to
+    fftw's measured plans (radix without fftw). A spectral ops run times
+    every kernel of SpectralOps.h on every instruction set, per bin of a
+    frame of each fft size, and checks its output against the same
+    operation in double precision. A latency run feeds one impulse through
+    the passthrough processor with every frame scheduling, the worker paced
+    in real time, and checks that it comes out exactly at the latency the
+    processor reports to the host.
+
+    Every run also checks the output against the input delayed by the
+    reported latency. With the passthrough processor that has to match to
+    within float rounding, so an optimisation that breaks reconstruction
+    fails the benchmark (exit code 1) instead of just looking fast. Stereo
+    runs with the packed pair transform are also compared with the same run
+    on the per channel transforms, for any processor. Convolution runs are
+    compared with a direct convolution over the last samples of the run,
+    with a decaying noise impulse response of --ir-seconds.
+
+    usage: ProcessorBenchmark [options]
+      --fft-sizes=<n,...>    default 256,512,1024,2048,4096,8192
+      --hops=<n,...>         default 64,128,256,512,1024 (those the window
+                             supports at the fft size, see getMaxHopSize)
+      --block-sizes=<n,...>  default 64,256,512,1024
+      --channels=<n,...>     1 and/or 2, default both
+      --seconds=<s>          audio per run at 48 kHz, default 2
+      --window=<name>, --scheduling=<name>, --processor=<name>, --backend=<name>,
+      --stereo-transform=<name>
+      --ir-seconds=<s>       impulse response length for the convolution
+                             processor, default 1
+      --instances=<n>        prepare n processors side by side with the first
+                             configuration, default 16, 0 to skip
+      --kernels=<0|1>        compare the fft kernels at the fft sizes, default 1
+      --spectral-ops=<0|1>   time and check the spectral ops kernels at the fft
+                             sizes, default 1
+      --latency=<0|1>        check the reported latency with an impulse at
+                             the fft sizes and hops, default 1
+      --output=<file>        write the results there instead of stdout
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/RealtimeAllocationGuard.h"
+#include "../../../Source/FftResourceRegistry.h"
+#include "../../../Source/FixedSizeFftBackend.h"
+#include "../../../Source/SpectralOps.h"
+
+//==============================================================================
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    // largest difference to the delayed input a passthrough run may show
+    constexpr float maxReconstructionError = 1.0e-4f;
+    // largest difference between the packed pair and per channel transforms
+    constexpr float maxPackingDifference = 1.0e-5f;
+    // largest difference between the bins of a kernel and the reference
+    // backend, relative to the largest bin
+    constexpr float maxKernelDifference = 1.0e-5f;
+    // largest difference between a spectral ops kernel and the same
+    // operation in double precision, relative to the largest result (or 1)
+    constexpr float maxSpectralOpsError = 1.0e-6f;
+    // largest difference to a direct convolution, relative to its peak
+    constexpr float maxConvolutionError = 1.0e-4f;
+    // output samples compared with the direct convolution, each costs one
+    // multiply-add per impulse response sample
+    constexpr int numConvolutionChecks = 1024;
+
+    struct BenchmarkSettings
+    {
+        juce::StringPairArray choices;
+        FftBackendType backend = FftBackendType::automatic;
+        double seconds = 2.0;
+        // reconstruction only holds for the passthrough processor, and with
+        // the worker thread only when it is paced like a real audio device
+        bool checkReconstruction = true;
+        // stereo runs with packed pairs are compared with per channel ones,
+        // unless the worker thread makes the output timing dependent
+        bool checkPacking = false;
+        // the convolution processor's filter, nullptr for the others. its
+        // output is checked unless the worker thread runs the frames.
+        std::shared_ptr<const ImpulseResponse> impulseResponse;
+        bool checkConvolution = false;
+        // the window the runs use, hops it doesn't support are skipped
+        WindowType window = WindowType::hann;
+    };
+
+    juce::Array<int> parseList(const juce::ArgumentList& args, const char* option, juce::Array<int> defaults) {
+        if (! args.containsOption(option)) {
+            return defaults;
+        }
+        juce::Array<int> values;
+        for (auto& item : juce::StringArray::fromTokens(args.getValueForOption(option), ",", {})) {
+            if (item.getIntValue() > 0) {
+                values.add(item.getIntValue());
+            }
+        }
+        return values;
+    }
+
+    // deterministic test signal, a few partials plus noise, different per channel
+    void fillInput(juce::AudioBuffer<float>& input) {
+        juce::Random random(1234);
+        for (int ch=0; ch<input.getNumChannels(); ch++) {
+            float* data = input.getWritePointer(ch);
+            for (int i=0; i<input.getNumSamples(); i++) {
+                const double t = i / sampleRate;
+                data[i] = (float) (0.3 * std::sin(juce::MathConstants<double>::twoPi * (220.0 + 110.0 * ch) * t)
+                                   + 0.2 * std::sin(juce::MathConstants<double>::twoPi * 3520.0 * t)
+                                   + 0.1 * (random.nextDouble() * 2.0 - 1.0));
+            }
+        }
+    }
+
+    // white noise under an exponential decay of 60 dB over its length, a
+    // crude room with the cost of a real one
+    std::shared_ptr<const ImpulseResponse> makeTestImpulseResponse(double seconds) {
+        juce::Random random(4321);
+        juce::AudioBuffer<float> samples(2, juce::jmax(1, juce::roundToInt(seconds * sampleRate)));
+        for (int ch=0; ch<samples.getNumChannels(); ch++) {
+            float* data = samples.getWritePointer(ch);
+            for (int i=0; i<samples.getNumSamples(); i++) {
+                data[i] = (float) ((random.nextDouble() * 2.0 - 1.0) * std::pow(0.001, (double) i / samples.getNumSamples()) * 0.05);
+            }
+        }
+        return makeImpulseResponse(samples, sampleRate);
+    }
+}
+
+// applies the settings and prepares the processor, returns false if the
+// configuration can't be set up
+static bool prepareProcessor(FftPassthroughAudioProcessor& processor, const BenchmarkSettings& settings,
+                             int fftSize, int hopSize, int blockSize, int numChannels) {
+    for (auto& id : settings.choices.getAllKeys()) {
+        processor.setChoiceParameter(id, settings.choices[id]);
+    }
+    if (! processor.setChoiceParameter("fftSize", juce::String(fftSize))
+        || ! processor.setChoiceParameter("hopSize", juce::String(hopSize))) {
+        return false;
+    }
+    processor.setFftBackend(settings.backend);
+    if (settings.impulseResponse != nullptr) {
+        processor.setImpulseResponse(settings.impulseResponse->samples, settings.impulseResponse->sampleRate);
+    }
+
+    const auto layout = numChannels == 1 ? juce::AudioChannelSet::mono() : juce::AudioChannelSet::stereo();
+    juce::AudioProcessor::BusesLayout buses;
+    buses.inputBuses.add(layout);
+    buses.outputBuses.add(layout);
+    if (! processor.setBusesLayout(buses)) {
+        return false;
+    }
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+    return true;
+}
+
+// runs buffer through the processor in place, blockSize samples at a time
+static void processInBlocks(FftPassthroughAudioProcessor& processor, juce::AudioBuffer<float>& buffer, int blockSize) {
+    juce::MidiBuffer midi;
+    for (int start=0; start + blockSize<=buffer.getNumSamples(); start+=blockSize) {
+        float* channels[2];
+        for (int ch=0; ch<buffer.getNumChannels(); ch++) {
+            channels[ch] = buffer.getWritePointer(ch, start);
+        }
+        juce::AudioBuffer<float> block(channels, buffer.getNumChannels(), blockSize);
+        processor.processBlock(block, midi);
+    }
+}
+
+static juce::var getRegistryStats() {
+    const auto stats = FftResourceRegistry::getInstance().getStats();
+    auto* result = new juce::DynamicObject();
+    result->setProperty("entries", stats.numEntries);
+    result->setProperty("references", stats.numReferences);
+    result->setProperty("bytes", stats.numBytes);
+    result->setProperty("bytesShared", stats.numBytesShared);
+    result->setProperty("hits", stats.numHits);
+    result->setProperty("misses", stats.numMisses);
+    result->setProperty("secondsCreating", stats.secondsCreating);
+    return juce::var(result);
+}
+
+// prepares numInstances processors that stay alive together and times the
+// setup and prepareToPlay of each. the first one builds the shared plans and tables, the later
+// ones should find them in the registry.
+static juce::var runInstancing(const BenchmarkSettings& settings, int fftSize, int hopSize, int blockSize, int numInstances) {
+    std::vector<std::unique_ptr<FftPassthroughAudioProcessor>> processors;
+    std::vector<double> prepareMs;
+    for (int i=0; i<numInstances; i++) {
+        auto processor = std::make_unique<FftPassthroughAudioProcessor>();
+        const auto start = juce::Time::getHighResolutionTicks();
+        if (! prepareProcessor(*processor, settings, fftSize, hopSize, blockSize, 2)) {
+            return {};
+        }
+        prepareMs.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1.0e3);
+        processors.push_back(std::move(processor));
+    }
+
+    double laterMs = 0.0;
+    for (size_t i=1; i<prepareMs.size(); i++) {
+        laterMs += prepareMs[i];
+    }
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("instances", numInstances);
+    result->setProperty("fftSize", fftSize);
+    result->setProperty("hopSize", hopSize);
+    result->setProperty("firstPrepareMs", prepareMs.front());
+    result->setProperty("meanLaterPrepareMs", numInstances > 1 ? laterMs / (numInstances - 1) : 0.0);
+    // taken while all instances are alive
+    result->setProperty("registry", getRegistryStats());
+    for (auto& processor : processors) {
+        processor->releaseResources();
+    }
+    return juce::var(result);
+}
+
+// times forward + inverse split transform pairs on backend, the best of a few
+// runs, and compares its bins of input with reference. isa names the
+// instruction set of the fixed size kernels.
+static juce::var runKernel(FftBackend& backend, const char* isa, const std::vector<float>& input, const std::vector<float>& reference,
+                           double referenceNs, double& ns, float& difference) {
+    const int fftSize = (int) input.size();
+    const int stride = SpectralFrame::getChannelStride(fftSize);
+    const int paddedBins = SpectralFrame::getPaddedNumBins(fftSize);
+    AlignedBuffer<float> frame((size_t) fftSize), bins((size_t) stride);
+    std::copy(input.begin(), input.end(), frame.get());
+    backend.prepare(fftSize, 1);
+
+    backend.forwardSplit(frame.get(), bins.get(), bins.get() + paddedBins, 1, stride);
+    float largest = 0.0f;
+    difference = 0.0f;
+    if (! reference.empty()) {
+        for (int i=0; i<stride; i++) {
+            largest = juce::jmax(largest, std::abs(reference[(size_t) i]));
+            difference = juce::jmax(difference, std::abs(bins[(size_t) i] - reference[(size_t) i]));
+        }
+        difference /= juce::jmax(largest, 1.0e-9f);
+    }
+
+    const int pairsPerRun = juce::jmax(16, (1 << 20) / fftSize);
+    double best = std::numeric_limits<double>::max();
+    for (int run=-1; run<5; run++) {
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int i=0; i<pairsPerRun; i++) {
+            backend.forwardSplit(frame.get(), bins.get(), bins.get() + paddedBins, 1, stride);
+            backend.inverseSplit(bins.get(), bins.get() + paddedBins, frame.get(), 1, stride);
+            // keep the data bounded between iterations
+            juce::FloatVectorOperations::multiply(frame.get(), 1.0f / (float) fftSize, fftSize);
+        }
+        const double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        if (run >= 0) {
+            best = juce::jmin(best, elapsed * 1.0e9 / pairsPerRun);
+        }
+    }
+    ns = best;
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("backend", backend.getName());
+    if (isa != nullptr) {
+        result->setProperty("isa", isa);
+    }
+    result->setProperty("nsPerPair", ns);
+    if (referenceNs > 0.0) {
+        result->setProperty("timeVsReference", ns / referenceNs);
+    }
+    if (! reference.empty()) {
+        result->setProperty("maxDifference", difference);
+    }
+    return juce::var(result);
+}
+
+// compares the fft kernels at fftSize: the reference backend (fftw if it's
+// compiled in, radix otherwise), the others, and the fixed size kernels on
+// every instruction set the cpu runs
+static juce::var runKernelComparison(int fftSize, bool& kernelsFailed) {
+    std::vector<float> input((size_t) fftSize);
+    juce::Random random(fftSize);
+    for (auto& sample : input) {
+        sample = random.nextFloat() * 2.0f - 1.0f;
+    }
+
+   #if FFT_USE_FFTW
+    const auto referenceType = FftBackendType::fftw;
+   #else
+    const auto referenceType = FftBackendType::radix;
+   #endif
+    juce::Array<juce::var> kernels;
+    double ns = 0.0, referenceNs = 0.0;
+    float difference = 0.0f;
+
+    // the reference's bins, for the others to be compared with
+    std::vector<float> reference;
+    {
+        auto backend = createFftBackend(referenceType, fftSize);
+        kernels.add(runKernel(*backend, nullptr, input, {}, 0.0, referenceNs, difference));
+        const int stride = SpectralFrame::getChannelStride(fftSize);
+        AlignedBuffer<float> bins((size_t) stride);
+        backend->forwardSplit(input.data(), bins.get(), bins.get() + SpectralFrame::getPaddedNumBins(fftSize), 1, stride);
+        reference.assign(bins.get(), bins.get() + stride);
+    }
+
+    for (auto type : { FftBackendType::fftw, FftBackendType::juce, FftBackendType::radix }) {
+        auto backend = createFftBackend(type, fftSize);
+        if (type != referenceType && std::strcmp(backend->getName(), getFftBackendName(type)) == 0) {
+            kernels.add(runKernel(*backend, nullptr, input, reference, referenceNs, ns, difference));
+        }
+    }
+    if (fixedfft::isSupportedSize(fftSize)) {
+        for (auto isa : simd::allIsas) {
+            if (! simd::isAvailable(isa)) {
+                continue;
+            }
+            FixedSizeFftBackend backend(isa);
+            kernels.add(runKernel(backend, simd::getIsaName(isa), input, reference, referenceNs, ns, difference));
+            if (difference > maxKernelDifference) {
+                kernelsFailed = true;
+            }
+        }
+    }
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("fftSize", fftSize);
+    result->setProperty("reference", getFftBackendName(referenceType));
+    result->setProperty("kernels", kernels);
+    return juce::var(result);
+}
+
+//==============================================================================
+// a frame of inputs for the spectral ops kernels, and the two outputs they
+// write. in place kernels work on the outputs, filled with a first.
+struct SpectralOpsFrame
+{
+    int numBins = 0;
+    std::vector<float> aRe, aIm, bRe, bIm, magnitude, phase, gain;
+    std::vector<float> outRe, outIm;
+};
+
+// one kernel: run calls it on the frame, reference is its result for bin k
+// in double precision. a kernel with a single result writes it to outRe[0].
+struct SpectralOp
+{
+    const char* name;
+    bool hasImag;
+    bool singleResult;
+    std::function<void(const spectralops::Kernels&, SpectralOpsFrame&)> run;
+    std::function<std::pair<double, double>(const SpectralOpsFrame&, int)> reference;
+};
+
+static std::vector<SpectralOp> getSpectralOps() {
+    using Kernels = spectralops::Kernels;
+    using Frame = SpectralOpsFrame;
+    constexpr float gateThreshold = 0.25f;
+    constexpr float smoothing = 0.3f;
+    const auto at = [] (const std::vector<float>& v, int k) { return (double) v[(size_t) k]; };
+    return {
+        { "magnitude", false, false,
+          [] (const Kernels& k, Frame& f) { k.magnitude(f.aRe.data(), f.aIm.data(), f.outRe.data(), f.numBins); },
+          [at] (const Frame& f, int k) { return std::make_pair(std::hypot(at(f.aRe, k), at(f.aIm, k)), 0.0); } },
+        { "power", false, false,
+          [] (const Kernels& k, Frame& f) { k.power(f.aRe.data(), f.aIm.data(), f.outRe.data(), f.numBins); },
+          [at] (const Frame& f, int k) { return std::make_pair(at(f.aRe, k) * at(f.aRe, k) + at(f.aIm, k) * at(f.aIm, k), 0.0); } },
+        { "toPolar", true, false,
+          [] (const Kernels& k, Frame& f) { k.toPolar(f.aRe.data(), f.aIm.data(), f.outRe.data(), f.outIm.data(), f.numBins); },
+          [at] (const Frame& f, int k) {
+              return std::make_pair(std::hypot(at(f.aRe, k), at(f.aIm, k)), std::atan2(at(f.aIm, k), at(f.aRe, k)));
+          } },
+        { "fromPolar", true, false,
+          [] (const Kernels& k, Frame& f) { k.fromPolar(f.magnitude.data(), f.phase.data(), f.outRe.data(), f.outIm.data(), f.numBins); },
+          [at] (const Frame& f, int k) {
+              return std::make_pair(at(f.magnitude, k) * std::cos(at(f.phase, k)), at(f.magnitude, k) * std::sin(at(f.phase, k)));
+          } },
+        { "applyGain", true, false,
+          [] (const Kernels& k, Frame& f) { k.applyGain(f.outRe.data(), f.outIm.data(), f.gain.data(), f.numBins); },
+          [at] (const Frame& f, int k) { return std::make_pair(at(f.aRe, k) * at(f.gain, k), at(f.aIm, k) * at(f.gain, k)); } },
+        { "gate", true, false,
+          [] (const Kernels& k, Frame& f) { k.gate(f.outRe.data(), f.outIm.data(), gateThreshold, f.numBins); },
+          [at] (const Frame& f, int k) {
+              const bool below = at(f.aRe, k) * at(f.aRe, k) + at(f.aIm, k) * at(f.aIm, k) < gateThreshold;
+              return below ? std::make_pair(0.0, 0.0) : std::make_pair(at(f.aRe, k), at(f.aIm, k));
+          } },
+        { "multiply", true, false,
+          [] (const Kernels& k, Frame& f) {
+              k.multiply(f.aRe.data(), f.aIm.data(), f.bRe.data(), f.bIm.data(), f.outRe.data(), f.outIm.data(), f.numBins);
+          },
+          [at] (const Frame& f, int k) {
+              return std::make_pair(at(f.aRe, k) * at(f.bRe, k) - at(f.aIm, k) * at(f.bIm, k),
+                                    at(f.aRe, k) * at(f.bIm, k) + at(f.aIm, k) * at(f.bRe, k));
+          } },
+        { "multiplyAdd", true, false,
+          [] (const Kernels& k, Frame& f) {
+              k.multiplyAdd(f.outRe.data(), f.outIm.data(), f.aRe.data(), f.aIm.data(), f.bRe.data(), f.bIm.data(), f.numBins);
+          },
+          [at] (const Frame& f, int k) {
+              return std::make_pair(at(f.aRe, k) + at(f.aRe, k) * at(f.bRe, k) - at(f.aIm, k) * at(f.bIm, k),
+                                    at(f.aIm, k) + at(f.aRe, k) * at(f.bIm, k) + at(f.aIm, k) * at(f.bRe, k));
+          } },
+        { "minimum", false, false,
+          [] (const Kernels& k, Frame& f) { k.minimum(f.aRe.data(), f.bRe.data(), f.outRe.data(), f.numBins); },
+          [at] (const Frame& f, int k) { return std::make_pair(juce::jmin(at(f.aRe, k), at(f.bRe, k)), 0.0); } },
+        { "maximum", false, false,
+          [] (const Kernels& k, Frame& f) { k.maximum(f.aRe.data(), f.bRe.data(), f.outRe.data(), f.numBins); },
+          [at] (const Frame& f, int k) { return std::make_pair(juce::jmax(at(f.aRe, k), at(f.bRe, k)), 0.0); } },
+        { "smooth", false, false,
+          [] (const Kernels& k, Frame& f) { k.smooth(f.outRe.data(), f.bRe.data(), smoothing, f.numBins); },
+          [at] (const Frame& f, int k) { return std::make_pair(at(f.aRe, k) + smoothing * (at(f.bRe, k) - at(f.aRe, k)), 0.0); } },
+        { "getPeakPower", false, true,
+          [] (const Kernels& k, Frame& f) { f.outRe[0] = k.getPeakPower(f.aRe.data(), f.aIm.data(), f.numBins); },
+          [at] (const Frame& f, int) {
+              double peak = 0.0;
+              for (int k=0; k<f.numBins; k++) {
+                  peak = juce::jmax(peak, at(f.aRe, k) * at(f.aRe, k) + at(f.aIm, k) * at(f.aIm, k));
+              }
+              return std::make_pair(peak, 0.0);
+          } },
+    };
+}
+
+// times every spectral ops kernel on every instruction set over a frame of
+// fftSize/2+1 bins, the best of a few runs, and checks its results
+static juce::var runSpectralOps(int fftSize, bool& spectralOpsFailed) {
+    SpectralOpsFrame frame;
+    frame.numBins = fftSize / 2 + 1;
+    const auto numBins = (size_t) frame.numBins;
+    juce::Random random(fftSize);
+    for (auto* v : { &frame.aRe, &frame.aIm, &frame.bRe, &frame.bIm }) {
+        v->resize(numBins);
+        for (auto& x : *v) {
+            x = random.nextFloat() * 2.0f - 1.0f;
+        }
+    }
+    // the origin and the axes, where atan2 changes octant
+    const float axes[][2] = { { 0.0f, 0.0f }, { -1.0f, 0.0f }, { 0.0f, -1.0f }, { 0.0f, 1.0f }, { 1.0f, 0.0f } };
+    for (size_t k=0; k<std::size(axes) && k<numBins; k++) {
+        frame.aRe[k] = axes[k][0];
+        frame.aIm[k] = axes[k][1];
+    }
+    frame.magnitude.resize(numBins);
+    frame.phase.resize(numBins);
+    frame.gain.resize(numBins);
+    for (size_t k=0; k<numBins; k++) {
+        frame.magnitude[k] = random.nextFloat();
+        // a few turns either way, as unwrapped phases are, and every fourth
+        // bin one accumulated up to the 1e5 radians fromPolar is good for
+        const float phaseRange = k % 4 == 3 ? 1.0e5f : 4.0f * juce::MathConstants<float>::pi;
+        frame.phase[k] = (random.nextFloat() * 2.0f - 1.0f) * phaseRange;
+        // gains of +-1 keep the in place kernels bounded over the timing runs
+        frame.gain[k] = random.nextBool() ? 1.0f : -1.0f;
+    }
+
+    juce::Array<juce::var> ops;
+    for (const auto& op : getSpectralOps()) {
+        double scalarNs = 0.0;
+        for (auto isa : simd::allIsas) {
+            if (! simd::isAvailable(isa)) {
+                continue;
+            }
+            const auto& kernels = spectralops::getKernels(isa);
+            frame.outRe = frame.aRe;
+            frame.outIm = frame.aIm;
+            op.run(kernels, frame);
+
+            double error = 0.0, largest = 1.0;
+            for (int k=0; k<(op.singleResult ? 1 : frame.numBins); k++) {
+                const auto expected = op.reference(frame, k);
+                largest = juce::jmax(largest, std::abs(expected.first), std::abs(expected.second));
+                error = juce::jmax(error, std::abs(frame.outRe[(size_t) k] - expected.first));
+                if (op.hasImag) {
+                    error = juce::jmax(error, std::abs(frame.outIm[(size_t) k] - expected.second));
+                }
+            }
+            error /= largest;
+            if (error > maxSpectralOpsError) {
+                spectralOpsFailed = true;
+            }
+
+            const int callsPerRun = juce::jmax(16, (1 << 20) / frame.numBins);
+            double best = std::numeric_limits<double>::max();
+            for (int run=-1; run<5; run++) {
+                const auto start = juce::Time::getHighResolutionTicks();
+                for (int i=0; i<callsPerRun; i++) {
+                    op.run(kernels, frame);
+                }
+                const double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                if (run >= 0) {
+                    best = juce::jmin(best, elapsed * 1.0e9 / ((double) callsPerRun * frame.numBins));
+                }
+            }
+            if (isa == simd::Isa::scalar) {
+                scalarNs = best;
+            }
+
+            auto* result = new juce::DynamicObject();
+            result->setProperty("kernel", op.name);
+            result->setProperty("isa", simd::getIsaName(kernels.isa));
+            result->setProperty("nsPerBin", best);
+            if (scalarNs > 0.0) {
+                result->setProperty("timeVsScalar", best / scalarNs);
+            }
+            result->setProperty("maxError", error);
+            ops.add(juce::var(result));
+        }
+    }
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("fftSize", fftSize);
+    result->setProperty("numBins", frame.numBins);
+    result->setProperty("ops", ops);
+    return juce::var(result);
+}
+
+// feeds one impulse through the passthrough processor with every frame
+// scheduling and finds the output peak, which has to land exactly on the
+// latency the processor reports to the host. the worker run is paced like an
+// audio device, one block per block of time, so its hops arrive in time.
+// returns a void var when the configuration can't be set up.
+static juce::var runLatency(const BenchmarkSettings& settings, int fftSize, int hopSize, int blockSize, bool& latencyFailed) {
+    auto passthroughSettings = settings;
+    passthroughSettings.choices.set("processor", getSpectralProcessorName(SpectralProcessorType::passthrough));
+    passthroughSettings.impulseResponse = nullptr;
+
+    juce::Array<juce::var> modes;
+    for (auto scheduling : { FrameScheduling::immediate, FrameScheduling::spread, FrameScheduling::worker }) {
+        passthroughSettings.choices.set("scheduling", getFrameSchedulingName(scheduling));
+        FftPassthroughAudioProcessor processor;
+        if (! prepareProcessor(processor, passthroughSettings, fftSize, hopSize, blockSize, 1)) {
+            return {};
+        }
+        const int latency = processor.getLatencySamples();
+
+        // the impulse after the first frame, and enough blocks to get it back
+        const int impulseAt = fftSize;
+        const int numBlocks = (impulseAt + latency + fftSize) / blockSize + 1;
+        juce::AudioBuffer<float> buffer(1, numBlocks * blockSize);
+        buffer.clear();
+        buffer.setSample(0, impulseAt, 1.0f);
+
+        juce::MidiBuffer midi;
+        const double blockMs = blockSize / sampleRate * 1.0e3;
+        const double startMs = juce::Time::getMillisecondCounterHiRes();
+        for (int block=0; block<numBlocks; block++) {
+            float* channels[] = { buffer.getWritePointer(0, block * blockSize) };
+            juce::AudioBuffer<float> hostBuffer(channels, 1, blockSize);
+            processor.processBlock(hostBuffer, midi);
+            if (scheduling == FrameScheduling::worker) {
+                const double waitMs = startMs + (block + 1) * blockMs - juce::Time::getMillisecondCounterHiRes();
+                if (waitMs >= 1.0) {
+                    juce::Thread::sleep((int) waitMs);
+                }
+            }
+        }
+        const int numUnderruns = processor.getNumWorkerUnderruns();
+        processor.releaseResources();
+
+        int peakAt = 0;
+        for (int i=1; i<buffer.getNumSamples(); i++) {
+            if (std::abs(buffer.getSample(0, i)) > std::abs(buffer.getSample(0, peakAt))) {
+                peakAt = i;
+            }
+        }
+        const int peakDelay = peakAt - impulseAt;
+        if (peakDelay != latency) {
+            latencyFailed = true;
+        }
+
+        auto* mode = new juce::DynamicObject();
+        mode->setProperty("scheduling", getFrameSchedulingName(scheduling));
+        mode->setProperty("latency", latency);
+        mode->setProperty("peakDelay", peakDelay);
+        mode->setProperty("peak", buffer.getSample(0, peakAt));
+        mode->setProperty("workerUnderruns", numUnderruns);
+        mode->setProperty("latencyOk", peakDelay == latency);
+        modes.add(juce::var(mode));
+    }
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("fftSize", fftSize);
+    result->setProperty("hopSize", hopSize);
+    result->setProperty("blockSize", blockSize);
+    result->setProperty("modes", modes);
+    return juce::var(result);
+}
+
+//==============================================================================
+// runs one configuration, returns its results or a void var when the
+// configuration can't be set up
+static juce::var runBenchmark(const BenchmarkSettings& settings, int fftSize, int hopSize, int blockSize, int numChannels,
+                              bool& reconstructionFailed, bool& packingFailed, bool& convolutionFailed) {
+    FftPassthroughAudioProcessor processor;
+    if (! prepareProcessor(processor, settings, fftSize, hopSize, blockSize, numChannels)) {
+        return {};
+    }
+    const int latency = processor.getLatencySamples();
+    // the convolution sets its own hop
+    const int actualHopSize = processor.getRequestedConfig().hopSize;
+
+    const int numSamples = juce::roundToInt(settings.seconds * sampleRate);
+    juce::AudioBuffer<float> input(numChannels, numSamples);
+    juce::AudioBuffer<float> output(numChannels, numSamples);
+    fillInput(input);
+    output.makeCopyOf(input);
+
+    // the first frames only fill the rings, don't time them
+    const int numWarmupBlocks = (fftSize + blockSize - 1) / blockSize;
+    const int numBlocks = numSamples / blockSize;
+    std::vector<double> callbackNs;
+    callbackNs.reserve((size_t) numBlocks);
+    juce::int64 numAllocations = 0;
+    juce::MidiBuffer midi;
+
+    for (int block=0; block<numBlocks; block++) {
+        // wraps the host buffer without copying, like a host would pass it
+        float* channels[2];
+        for (int ch=0; ch<numChannels; ch++) {
+            channels[ch] = output.getWritePointer(ch, block * blockSize);
+        }
+        juce::AudioBuffer<float> buffer(channels, numChannels, blockSize);
+
+        const auto allocationsBefore = getNumAllocationsOnThisThread();
+        const auto start = juce::Time::getHighResolutionTicks();
+        processor.processBlock(buffer, midi);
+        const auto end = juce::Time::getHighResolutionTicks();
+        if (block >= numWarmupBlocks) {
+            callbackNs.push_back(juce::Time::highResolutionTicksToSeconds(end - start) * 1.0e9);
+            numAllocations += getNumAllocationsOnThisThread() - allocationsBefore;
+        }
+    }
+    const int numUnderruns = processor.getNumWorkerUnderruns();
+    processor.releaseResources();
+
+    // output sample i is input sample i - latency
+    float maxError = 0.0f;
+    for (int ch=0; ch<numChannels; ch++) {
+        for (int i=latency + fftSize; i<numBlocks * blockSize; i++) {
+            maxError = juce::jmax(maxError, std::abs(output.getSample(ch, i) - input.getSample(ch, i - latency)));
+        }
+    }
+    const bool reconstructs = maxError <= maxReconstructionError;
+    if (settings.checkReconstruction && ! reconstructs) {
+        reconstructionFailed = true;
+    }
+
+    // the same input through the per channel transforms has to come out the
+    // same to within float rounding
+    float packingDifference = -1.0f;
+    if (settings.checkPacking && numChannels == 2) {
+        auto perChannelSettings = settings;
+        perChannelSettings.choices.set("stereoTransform", "Per Channel");
+        FftPassthroughAudioProcessor reference;
+        if (prepareProcessor(reference, perChannelSettings, fftSize, hopSize, blockSize, numChannels)) {
+            juce::AudioBuffer<float> referenceOutput;
+            referenceOutput.makeCopyOf(input);
+            processInBlocks(reference, referenceOutput, blockSize);
+            reference.releaseResources();
+
+            packingDifference = 0.0f;
+            for (int ch=0; ch<numChannels; ch++) {
+                for (int i=0; i<numBlocks * blockSize; i++) {
+                    packingDifference = juce::jmax(packingDifference, std::abs(output.getSample(ch, i) - referenceOutput.getSample(ch, i)));
+                }
+            }
+            if (packingDifference > maxPackingDifference) {
+                packingFailed = true;
+            }
+        }
+    }
+
+    // the last numConvolutionChecks outputs against the direct convolution of
+    // the input, in double precision
+    float convolutionError = -1.0f;
+    if (settings.checkConvolution) {
+        const auto& response = settings.impulseResponse->samples;
+        double largestError = 0.0, peak = 0.0;
+        for (int ch=0; ch<numChannels; ch++) {
+            const float* h = response.getReadPointer(juce::jmin(ch, response.getNumChannels() - 1));
+            const float* x = input.getReadPointer(ch);
+            for (int i=juce::jmax(latency, numBlocks * blockSize - numConvolutionChecks); i<numBlocks * blockSize; i++) {
+                const int n = i - latency;
+                double y = 0.0;
+                for (int k=0; k<=n && k<response.getNumSamples(); k++) {
+                    y += (double) h[k] * x[n - k];
+                }
+                largestError = juce::jmax(largestError, std::abs(y - output.getSample(ch, i)));
+                peak = juce::jmax(peak, std::abs(y));
+            }
+        }
+        convolutionError = (float) (largestError / juce::jmax(peak, 1.0e-9));
+        if (convolutionError > maxConvolutionError) {
+            convolutionFailed = true;
+        }
+    }
+
+    std::sort(callbackNs.begin(), callbackNs.end());
+    const int numTimed = (int) callbackNs.size();
+    double totalNs = 0.0;
+    for (auto ns : callbackNs) {
+        totalNs += ns;
+    }
+    const double meanNs = numTimed > 0 ? totalNs / numTimed : 0.0;
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("fftSize", fftSize);
+    result->setProperty("hopSize", actualHopSize);
+    result->setProperty("blockSize", blockSize);
+    result->setProperty("channels", numChannels);
+    result->setProperty("latency", latency);
+    result->setProperty("callbacks", numTimed);
+    result->setProperty("nsPerSample", numTimed > 0 ? totalNs / ((double) numTimed * blockSize) : 0.0);
+    result->setProperty("meanCallbackNs", meanNs);
+    result->setProperty("p99CallbackNs", numTimed > 0 ? callbackNs[(size_t) ((numTimed - 1) * 99 / 100)] : 0.0);
+    result->setProperty("maxCallbackNs", numTimed > 0 ? callbackNs.back() : 0.0);
+    // the deadline is one block of audio, this is how much of it was used on average
+    result->setProperty("meanLoad", meanNs / (blockSize / sampleRate * 1.0e9));
+    if (getNumAllocationsOnThisThread() >= 0) {
+        result->setProperty("allocationsPerCallback", numTimed > 0 ? (double) numAllocations / numTimed : 0.0);
+    }
+    result->setProperty("workerUnderruns", numUnderruns);
+    result->setProperty("maxReconstructionError", maxError);
+    result->setProperty("reconstructionOk", reconstructs);
+    if (packingDifference >= 0.0f) {
+        result->setProperty("maxPackingDifference", packingDifference);
+        result->setProperty("packingOk", packingDifference <= maxPackingDifference);
+    }
+    if (convolutionError >= 0.0f) {
+        result->setProperty("convolutionError", convolutionError);
+        result->setProperty("convolutionOk", convolutionError <= maxConvolutionError);
+    }
+    return juce::var(result);
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    BenchmarkSettings settings;
+    const std::pair<const char*, const char*> choiceOptions[] = {
+        { "--window", "window" }, { "--scheduling", "scheduling" }, { "--processor", "processor" },
+        { "--stereo-transform", "stereoTransform" }
+    };
+    for (auto& option : choiceOptions) {
+        if (args.containsOption(option.first)) {
+            settings.choices.set(option.second, args.getValueForOption(option.first));
+        }
+    }
+    // a probe processor to validate the names before running anything
+    {
+        FftPassthroughAudioProcessor probe;
+        for (auto& id : settings.choices.getAllKeys()) {
+            if (! probe.setChoiceParameter(id, settings.choices[id])) {
+                std::cerr << "invalid " << id << " \"" << settings.choices[id] << "\"" << std::endl;
+                return 1;
+            }
+        }
+        const auto config = probe.getRequestedConfig();
+        settings.checkReconstruction = config.processor == SpectralProcessorType::passthrough
+                                       && config.scheduling != FrameScheduling::worker;
+        settings.window = config.window;
+        settings.checkPacking = config.packStereoPairs && config.scheduling != FrameScheduling::worker;
+        if (config.processor == SpectralProcessorType::convolution) {
+            const double irSeconds = args.containsOption("--ir-seconds") ? args.getValueForOption("--ir-seconds").getDoubleValue() : 1.0;
+            settings.impulseResponse = makeTestImpulseResponse(juce::jlimit(1.0 / sampleRate, maxImpulseResponseSeconds, irSeconds));
+            settings.checkConvolution = config.scheduling != FrameScheduling::worker;
+        }
+    }
+    if (args.containsOption("--backend")) {
+        const auto wanted = args.getValueForOption("--backend").toLowerCase();
+        bool found = false;
+        for (auto type : { FftBackendType::automatic, FftBackendType::fftw, FftBackendType::juce, FftBackendType::radix,
+                           FftBackendType::fixedSize }) {
+            if (juce::String(getFftBackendName(type)).toLowerCase() == wanted) {
+                settings.backend = type;
+                found = true;
+            }
+        }
+        if (! found) {
+            std::cerr << "unknown backend " << wanted << std::endl;
+            return 1;
+        }
+    }
+    if (args.containsOption("--seconds")) {
+        settings.seconds = juce::jmax(0.1, args.getValueForOption("--seconds").getDoubleValue());
+    }
+
+    const auto fftSizes = parseList(args, "--fft-sizes", { 256, 512, 1024, 2048, 4096, 8192 });
+    auto hopSizes = parseList(args, "--hops", { 64, 128, 256, 512, 1024 });
+    // the convolution always hops by half a frame, one pass is enough
+    if (settings.impulseResponse != nullptr && hopSizes.size() > 1) {
+        hopSizes.removeRange(1, hopSizes.size() - 1);
+    }
+    const auto blockSizes = parseList(args, "--block-sizes", { 64, 256, 512, 1024 });
+    const auto channelCounts = parseList(args, "--channels", { 1, 2 });
+
+    const int numInstances = args.containsOption("--instances") ? args.getValueForOption("--instances").getIntValue() : 16;
+    juce::var instancing;
+    if (numInstances > 0 && ! fftSizes.isEmpty() && ! hopSizes.isEmpty() && ! blockSizes.isEmpty()) {
+        instancing = runInstancing(settings, fftSizes[0], juce::jmin(hopSizes[0], getMaxHopSize(settings.window, fftSizes[0])),
+                                   blockSizes[0], numInstances);
+        std::cerr << juce::JSON::toString(instancing, true) << std::endl;
+    }
+
+    juce::Array<juce::var> kernelResults;
+    bool kernelsFailed = false;
+    if (! args.containsOption("--kernels") || args.getValueForOption("--kernels").getIntValue() != 0) {
+        for (int fftSize : fftSizes) {
+            auto result = runKernelComparison(fftSize, kernelsFailed);
+            std::cerr << juce::JSON::toString(result, true) << std::endl;
+            kernelResults.add(result);
+        }
+    }
+
+    juce::Array<juce::var> spectralOpsResults;
+    bool spectralOpsFailed = false;
+    if (! args.containsOption("--spectral-ops") || args.getValueForOption("--spectral-ops").getIntValue() != 0) {
+        for (int fftSize : fftSizes) {
+            auto result = runSpectralOps(fftSize, spectralOpsFailed);
+            std::cerr << juce::JSON::toString(result, true) << std::endl;
+            spectralOpsResults.add(result);
+        }
+    }
+
+    // every supported hop at the first block size, the worker runs take
+    // their length in real time
+    juce::Array<juce::var> latencyResults;
+    bool latencyFailed = false;
+    if ((! args.containsOption("--latency") || args.getValueForOption("--latency").getIntValue() != 0)
+        && ! blockSizes.isEmpty()) {
+        for (int fftSize : fftSizes) {
+            for (int hopSize : hopSizes) {
+                if (hopSize > getMaxHopSize(settings.window, fftSize)) {
+                    continue;
+                }
+                auto result = runLatency(settings, fftSize, hopSize, blockSizes[0], latencyFailed);
+                if (result.isVoid()) {
+                    continue;
+                }
+                std::cerr << juce::JSON::toString(result, true) << std::endl;
+                latencyResults.add(result);
+            }
+        }
+    }
+
+    juce::Array<juce::var> results;
+    bool reconstructionFailed = false, packingFailed = false, convolutionFailed = false;
+    for (int fftSize : fftSizes) {
+        for (int hopSize : hopSizes) {
+            if (hopSize > getMaxHopSize(settings.window, fftSize)) {
+                continue;
+            }
+            for (int blockSize : blockSizes) {
+                for (int numChannels : channelCounts) {
+                    auto result = runBenchmark(settings, fftSize, hopSize, blockSize, juce::jlimit(1, 2, numChannels),
+                                               reconstructionFailed, packingFailed, convolutionFailed);
+                    if (result.isVoid()) {
+                        std::cerr << "skipped fft " << fftSize << " hop " << hopSize << ": not a parameter choice" << std::endl;
+                        continue;
+                    }
+                    std::cerr << juce::JSON::toString(result, true) << std::endl;
+                    results.add(result);
+                }
+            }
+        }
+    }
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty("backend", getFftBackendName(settings.backend));
+    report->setProperty("reconstructionChecked", settings.checkReconstruction);
+    report->setProperty("reconstructionOk", ! reconstructionFailed);
+    report->setProperty("packingChecked", settings.checkPacking);
+    report->setProperty("packingOk", ! packingFailed);
+    if (settings.impulseResponse != nullptr) {
+        report->setProperty("irSeconds", settings.impulseResponse->getNumSamples() / sampleRate);
+        report->setProperty("convolutionChecked", settings.checkConvolution);
+        report->setProperty("convolutionOk", ! convolutionFailed);
+    }
+    report->setProperty("results", results);
+    if (! kernelResults.isEmpty()) {
+        report->setProperty("kernels", kernelResults);
+        report->setProperty("kernelsOk", ! kernelsFailed);
+    }
+    if (! spectralOpsResults.isEmpty()) {
+        report->setProperty("spectralOps", spectralOpsResults);
+        report->setProperty("spectralOpsOk", ! spectralOpsFailed);
+    }
+    if (! latencyResults.isEmpty()) {
+        report->setProperty("latency", latencyResults);
+        report->setProperty("latencyOk", ! latencyFailed);
+    }
+    if (! instancing.isVoid()) {
+        report->setProperty("instancing", instancing);
+    }
+    report->setProperty("registry", getRegistryStats());
+    const auto json = juce::JSON::toString(juce::var(report));
+
+    if (args.containsOption("--output")) {
+        if (! args.getFileForOption("--output").replaceWithText(json)) {
+            std::cerr << "can't write " << args.getFileForOption("--output").getFullPathName() << std::endl;
+            return 1;
+        }
+    } else {
+        std::cout << json << std::endl;
+    }
+
+    if (reconstructionFailed) {
+        std::cerr << "reconstruction check failed" << std::endl;
+    }
+    if (packingFailed) {
+        std::cerr << "packed stereo transform differs from the per channel one" << std::endl;
+    }
+    if (convolutionFailed) {
+        std::cerr << "convolution differs from the direct convolution" << std::endl;
+    }
+    if (kernelsFailed) {
+        std::cerr << "fixed size fft kernels differ from the reference backend" << std::endl;
+    }
+    if (spectralOpsFailed) {
+        std::cerr << "spectral ops kernels differ from the double precision results" << std::endl;
+    }
+    if (latencyFailed) {
+        std::cerr << "an impulse doesn't come out at the reported latency" << std::endl;
+    }
+    return reconstructionFailed || packingFailed || convolutionFailed || kernelsFailed || spectralOpsFailed || latencyFailed ? 1 : 0;
+}